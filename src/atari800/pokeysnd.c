@@ -178,6 +178,7 @@ int POKEYSND_stereo_enabled = FALSE;
 #endif
 
 int POKEYSND_volume = 0x100;
+int POKEYSND_sample_shift = 0;
 
 /* multiple sound engine interface */
 static void pokeysnd_process_8(void *sndbuffer, int sndn);
@@ -1192,7 +1193,7 @@ static void pokeysnd_process_8(void *sndbuffer, int sndn)
             int s = iout - (_lp >> 8) + 128;        // hipass to center on 128
             if (s < 0) s = 0;
             if (s > 255) s = 255;
-            *buffer++ = s;                          // 8 bit unsigned
+            *buffer++ = s >> POKEYSND_sample_shift; // 8 bit unsigned, or fewer bits
 
 #ifdef STEREO_SOUND
 			if (Num_pokeys > 1)
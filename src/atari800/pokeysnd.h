@@ -83,6 +83,7 @@ extern SLONG POKEYSND_playback_freq;
 extern UBYTE POKEYSND_num_pokeys;
 extern int POKEYSND_snd_flags;
 extern int POKEYSND_volume;
+extern int POKEYSND_sample_shift;	/* 8 bit output shifted down to fewer bits */
 
 extern int POKEYSND_enable_new_pokey;
 extern int POKEYSND_stereo_enabled;
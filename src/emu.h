@@ -52,6 +52,15 @@ enum {
 extern "C"
 void* MALLOC32(int size, const char* name);
 
+// The audio output ring, for cores that render straight into it: samples are
+// 6 bit unsigned (0x20 is silence) at audio_frequency, the format video_isr plays
+class AudioSink {
+public:
+    virtual int frame_samples(int n) = 0;   // samples to render for a frame nominally n long
+    virtual uint8_t* span() = 0;            // where they go, contiguous for frame_samples()
+    virtual void commit(int len) = 0;       // hand the len rendered samples to the output
+};
+
 class Emu {
 public:
 
@@ -126,7 +135,9 @@ public:
 
     virtual int update() = 0;
     virtual uint8_t** video_buffer() = 0;
-    virtual int audio_buffer(int16_t* b, int max_len) = 0;
+    virtual void resolve_video() {};    // make video_buffer() hold plain palette colors before the gui draws on it
+    virtual int audio_render(AudioSink& sink) { return -1; };   // frame's audio into the sink, -1 if unsupported
+    virtual int audio_buffer(int16_t* b, int max_len) { return 0; };
 
     virtual const uint32_t* ntsc_palette() { return NULL; };
     virtual const uint32_t* pal_palette() { return NULL; };
@@ -150,6 +161,9 @@ extern "C" FILE* mkfile(const char* path);
 extern "C" int unpack(const char* dst_path, const uint8_t* d, int len);
 
 void audio_write_16(const int16_t* s, int len, int channels);
+AudioSink& audio_sink();
+extern volatile uint32_t _audio_underruns;  // lines the audio ring was empty for
+extern volatile uint32_t _audio_overruns;   // samples dropped with the ring full
 int get_hid_ir(uint8_t* dst);
 uint32_t generic_map(uint32_t m, const uint32_t* target);
 
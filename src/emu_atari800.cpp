@@ -22,6 +22,7 @@
 extern "C" {
 #include "atari800/libatari800.h"
 #include "atari800/sound.h"
+#include "atari800/pokeysnd.h"
 #include "atari800/akey.h"
 #include "atari800/memory.h"
 }
@@ -949,6 +950,7 @@ public:
         _ext = _atari_ext;
         _help = _atari_help;
         Sound_desired.freq = audio_frequency;
+        POKEYSND_sample_shift = 2;          // 6 bit, the audio ring's own format
     }
 
     virtual void gen_palettes()
@@ -1325,15 +1327,12 @@ public:
         return _lines;
     }
 
-    virtual int audio_buffer(int16_t* b, int len)
+    virtual int audio_render(AudioSink& sink)
     {
-        int n = frame_sample_count();
-        Sound_Callback((uint8_t*)b,n);      // in bytes
-        uint8_t* b8 = (uint8_t*)b;
-        for (int i = n-1; i >= 0; i--) {
-            int s16 = (b8[i] ^ 0x80) << 8;
-            b[i] = s16;
-        }
+        int n = sink.frame_samples(frame_sample_count());
+        uint8_t* b = sink.span();
+        Sound_Callback(b,n);    // 6 bit unsigned, in place
+        sink.commit(n);
         return n;
     }
 
@@ -21,6 +21,7 @@
 extern "C" {
 #include "nofrendo/osd.h"
 #include "nofrendo/event.h"
+#include "nofrendo/new_ppu.h"
 };
 #include "math.h"
 #include "freertos/FreeRTOS.h"
@@ -198,7 +199,7 @@ extern "C"
 void osd_getsoundinfo(sndinfo_t *info)
 {
     info->sample_rate = _audio_frequency;
-    info->bps = 8;
+    info->bps = 6;  // the audio ring's own format
 }
 
 extern "C"
@@ -209,13 +210,38 @@ void osd_setsound(void (*playfunc)(void *buffer, int length))
 
 std::string to_string(int i);
 extern uint8_t** volatile _lines; // global video line pointers provided by PPU
+extern const uint32_t** volatile _line_palettes;
+
+#if NES_LINE_RING
+extern volatile int _line_counter;
+extern volatile int _frame_counter;
+class EmuNofrendo;
+static EmuNofrendo* _ring_emu = 0;
+static void ring_line_sync(int y);
+#endif
 
 class EmuNofrendo : public Emu {
     uint8_t** lines_;
+    uint32_t* color_tables_;            // 32 composite colors per ppu palette snapshot, odd pal lines after
+    const uint32_t* line_palettes_[240];
+#if NES_LINE_RING
+    uint8_t* frame_;                    // full frame the gui draws over, the ppu renders into it meanwhile
+    int frame_hold_;                    // updates left before going back to the ring
+    int live_set_;                      // color table set of the frame being drawn
+    int live_done_;                     // its snapshots colored so far
+#endif
 public:
-    EmuNofrendo(int ntsc) : Emu("nofrendo",256,240,ntsc,(16 | (1 << 8)),4,EMU_NES)    // audio is 16bit, 3 or 6 cc width
+    EmuNofrendo(int ntsc) : Emu("nofrendo",256,240,ntsc,(16 | (1 << 8)),4,EMU_NES)    // audio is 6bit into the ring, 3 or 6 cc width
     {
         lines_ = 0;
+        color_tables_ = 0;
+#if NES_LINE_RING
+        frame_ = 0;
+        frame_hold_ = 0;
+        live_set_ = 0;
+        live_done_ = 0;
+        _ring_emu = this;
+#endif
         _ext = _nes_ext;
         _help = _nes_help;
         _audio_frequency = audio_frequency;
@@ -448,8 +474,11 @@ public:
             return -1;
         }
 
+#if NES_LINE_RING
+        ppu_set_line_sync(ring_line_sync);
+#endif
         nes_emulate_frame(true);   // first frame to prime PPU
-        lines_ = _lines;
+        frame_done();
         if (!lines_) {
             printf("nes_emulate_frame failed\n");
             unmap_file(_nofrendo_rom);
@@ -462,32 +491,152 @@ public:
     virtual int update()
     {
         if (_nofrendo_rom) {
+#if NES_LINE_RING
+            if (frame_ && --frame_hold_ == 0) {
+                vid_setframe(0);        // gui is done with the full frame
+                free(frame_);
+                frame_ = 0;
+            }
+#endif
             nes_emulate_frame(true);
-            lines_ = _lines;
+            frame_done();
         }
         return 0;
     }
 
+    void frame_done()
+    {
+        lines_ = _lines;
+#if NES_LINE_RING
+        if (!frame_)
+            return;     // lines were colored as they were drawn
+#endif
+        update_line_palettes();
+    }
+
+    // 32 composite colors per snapshot, the odd pal line colors one set further
+    static const int color_set = (PPU_PAL_SNAPS + 7)*32;  // room for generations of a frame drawn since
+
+    uint32_t* color_table(int set)
+    {
+        int sets = standard ? 1 : 2;
+        if (!color_tables_)
+            color_tables_ = new uint32_t[(NES_LINE_RING ? 2 : 1)*sets*color_set]();
+        return color_tables_ + set*sets*color_set;
+    }
+
+    void color_snapshots(uint32_t* t, const ppu_pal_snap_t* snaps, int from, int to)
+    {
+        const uint32_t* pal = composite_palette();
+        for (int s = from; s < to; s++) {
+            for (int i = 0; i < 32; i++) {
+                uint8_t c = ppu_pal_resolve(snaps + s,i);
+                t[s*32 + i] = pal[c];
+                if (!standard)
+                    t[color_set + s*32 + i] = pal[64 + c];
+            }
+        }
+    }
+
+    const uint32_t* line_palette(uint32_t* t, int y, int base)
+    {
+        return t + ((!standard && (y & 1)) ? color_set : 0) + base*32;
+    }
+
+    // the ppu leaves palette/mask resolution to the blit: turn each palette snapshot
+    // of the frame into a table of composite colors and point every line at its own
+    void update_line_palettes()
+    {
+        const ppu_pal_snap_t* snaps;
+        const uint8_t* base;
+        int n = ppu_pal_snapshots(&snaps,&base);
+        uint32_t* t = color_table(0);
+        color_snapshots(t,snaps,0,n);
+        for (int y = 0; y < 240; y++)
+            line_palettes_[y] = line_palette(t,y,base[y]);
+        _line_palettes = line_palettes_;
+    }
+
+#if NES_LINE_RING
+    // beam racing: line y may only be drawn once the isr has shown the line before it in
+    // the same ring slot. a late emulator draws straight away and the isr shows stale lines
+    void sync_line(int y)
+    {
+        if (frame_)
+            return;
+        if (y < 240 && _frame_counter) {    // no pacing until the video isr runs
+            int count = standard ? 262 : 312;
+            for (;;) {
+                int beam = _line_counter - (standard ? 0 : 32);     // next line the isr shows
+                int ahead = (y - beam + 2*count) % count;
+                if (ahead < NES_LINE_RING || ahead >= count/2)
+                    break;
+            }
+        }
+
+        // color what was drawn since, again the latest snapshot as it may have changed in place
+        const ppu_pal_snap_t* snaps;
+        const uint8_t* base;
+        int n = ppu_pal_live(&snaps,&base);
+        if (y == 0) {
+            live_set_ ^= 1;             // the isr may still show the end of the last frame
+            live_done_ = 0;
+            _line_palettes = line_palettes_;
+        }
+        uint32_t* t = color_table(live_set_);
+        color_snapshots(t,snaps,live_done_ ? live_done_ - 1 : 0,n);
+        live_done_ = n;
+        if (y < 240)
+            line_palettes_[y] = line_palette(t,y,base[y]);
+    }
+#endif
+
+    virtual void resolve_video()
+    {
+#if NES_LINE_RING
+        // the gui needs a whole frame: the ring only holds the last few lines, so start from black
+        // and have the ppu render full frames until the gui is done
+        if (lines_ && !frame_) {
+            frame_ = (uint8_t*)malloc(width*height);
+            if (!frame_)
+                return;
+            memset(frame_,0x0F,width*height);
+            vid_setframe(frame_);
+            frame_hold_ = 2;
+            _line_palettes = 0;
+            return;
+        }
+        frame_hold_ = 2;
+#endif
+        if (!lines_ || !_line_palettes)
+            return;
+        const ppu_pal_snap_t* snaps;
+        const uint8_t* base;
+        int n = ppu_pal_snapshots(&snaps,&base);
+        for (int y = 0; y < height; y++) {
+            uint8_t* p = lines_[y];
+            for (int x = 0; x < width; x++) {
+                int s = base[y] + (p[x] >> PPU_PIX_GEN_SHIFT);
+                p[x] = ppu_pal_resolve(snaps + (s < n ? s : n - 1),p[x]);
+            }
+        }
+        _line_palettes = 0;
+    }
+
     virtual uint8_t** video_buffer()
     {
         return lines_;
     }
     
-    virtual int audio_buffer(int16_t* b, int len)
+    virtual int audio_render(AudioSink& sink)
     {
-        int n = frame_sample_count();
-        if (nes_sound_cb) {
-            nes_sound_cb(b,n);  // 8 bit unsigned
-            uint8_t* b8 = (uint8_t*)b;
-            for (int i = n-1; i >= 0; i--) {
-                b[i] = (b8[i] ^ 0x80) << 8;  // turn it back into signed 16
-                // Occasionally yield to allow lower priority tasks and the idle task to run
-                if ((i & 2047) == 0)
-                    vTaskDelay(0);
-            }
-        }
+        int n = sink.frame_samples(frame_sample_count());
+        uint8_t* b = sink.span();
+        if (nes_sound_cb)
+            nes_sound_cb(b,n);  // 6 bit unsigned, in place
         else
-            memset(b,0,2*n);
+            memset(b,0x20,n);
+        sink.commit(n);
         return n;
     }
 
@@ -504,6 +653,13 @@ public:
     }
 };
 
+#if NES_LINE_RING
+static void ring_line_sync(int y)
+{
+    _ring_emu->sync_line(y);
+}
+#endif
+
 Emu* NewNofrendo(int ntsc)
 {
     return new EmuNofrendo(ntsc);
@@ -943,6 +943,7 @@ public:
     void update_video()
     {
         if (_visible) {
+            _emu->resolve_video();
             menu();
             scrollbar();
             switch (_tab) {
@@ -957,6 +958,7 @@ public:
 
         // message goes over both
         if (_msg.size()) {
+            _emu->resolve_video();
             if (--_msg_ticks == 0) {
                 _overlay->erase_msg();
                 _msg.clear();
@@ -985,6 +987,8 @@ public:
             } else
               memset(abuffer,0,sizeof(abuffer));
         } else {
+            if (_emu->audio_render(audio_sink()) >= 0)
+                return;         // rendered straight into the ring
             sample_count = _emu->audio_buffer(abuffer,sizeof(abuffer));
         }
         audio_write_16(abuffer,sample_count,format);
@@ -494,6 +494,8 @@ static void gui_updatewave(int wave_type)
       /* initial old value */
       if (16 == vis_bps)
          oldval = 0x40 - (((((uint16 *) vis_buffer)[0] >> 8) ^ 0x80) >> 2);
+      else if (6 == vis_bps)
+         oldval = 0x40 - ((uint8 *) vis_buffer)[0];
       else
          oldval = 0x40 - (((uint8 *) vis_buffer)[0] >> 2);
 
@@ -502,6 +504,8 @@ static void gui_updatewave(int wave_type)
          //val = 0x40 - (vis_buffer[(uint32) (loop * scale)] >> 2);
          if (16 == vis_bps)
             val = 0x40 - (((((uint16 *) vis_buffer)[(uint32) (loop * scale)] >> 8) ^ 0x80) >> 2);
+         else if (6 == vis_bps)
+            val = 0x40 - ((uint8 *) vis_buffer)[(uint32) (loop * scale)];
          else
             val = 0x40 - (((uint8 *) vis_buffer)[(uint32) (loop * scale)] >> 2);
          if (oldval < val)
@@ -527,6 +531,8 @@ static void gui_updatewave(int wave_type)
          //val = vis_buffer[(uint32) (loop * scale)] >> 2;
          if (16 == vis_bps)
             val = ((((uint16 *) vis_buffer)[(uint32) (loop * scale)] >> 8) ^ 0x80) >> 2;
+         else if (6 == vis_bps)
+            val = ((uint8 *) vis_buffer)[(uint32) (loop * scale)];
          else
             val = ((uint8 *) vis_buffer)[(uint32) (loop * scale)] >> 2;
          if (val == 0x20)
@@ -51,12 +51,12 @@ not be possible.
 */
 
 /* TODO: roll this into something... */
-static int bitcount = 0;
-static uint8 latch = 0;
-static uint8 regs[4];
-static int bank_select;
-static uint8 lastreg;
-static int chr_page; /* 0 = $0000-$0FFF, 1 = $1000-$1FFF */
+static NES_LOCAL int bitcount = 0;
+static NES_LOCAL uint8 latch = 0;
+static NES_LOCAL uint8 regs[4];
+static NES_LOCAL int bank_select;
+static NES_LOCAL uint8 lastreg;
+static NES_LOCAL int chr_page; /* 0 = $0000-$0FFF, 1 = $1000-$1FFF */
 
 /* Update WRAM enable state based on current CHR page */
 static void map1_update_wram(void)
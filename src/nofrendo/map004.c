@@ -36,15 +36,15 @@ typedef struct {
     bool  reload_flag;
 } irq_t;
 
-static irq_t  irq;
-static uint8  reg8000;          /* last $8000 value               */
-static uint16 vrombase;         /* 0x0000 or 0x1000               */
-static uint8  prg_bank6;        /* last R6 value                  */
-static uint8  r7_prg_bank;      /* last R7 value (0xA000 bank)    */
-static bool   fourscreen;
-static bool   wram_en, wram_wp;
-static uint8  wram_bank; 
-static uint8 chr_reg[6];
+static NES_LOCAL irq_t  irq;
+static NES_LOCAL uint8  reg8000;          /* last $8000 value               */
+static NES_LOCAL uint16 vrombase;         /* 0x0000 or 0x1000               */
+static NES_LOCAL uint8  prg_bank6;        /* last R6 value                  */
+static NES_LOCAL uint8  r7_prg_bank;      /* last R7 value (0xA000 bank)    */
+static NES_LOCAL bool   fourscreen;
+static NES_LOCAL bool   wram_en, wram_wp;
+static NES_LOCAL uint8  wram_bank; 
+static NES_LOCAL uint8 chr_reg[6];
 
 
 
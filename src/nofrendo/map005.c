@@ -34,30 +34,30 @@
  * ------------------------------------------------------------------ */
 
 /* PRG/CHR configuration */
-static uint8 prg_mode;              /* $5100 */
-static uint8 chr_mode;              /* $5101 */
-static uint8 chr_high;              /* $5130 – upper bits for CHR banks */
+static NES_LOCAL uint8 prg_mode;              /* $5100 */
+static NES_LOCAL uint8 chr_mode;              /* $5101 */
+static NES_LOCAL uint8 chr_high;              /* $5130 – upper bits for CHR banks */
 
-static uint8 prg_reg[4];            /* $5114–$5117 */
-static uint16 chr_spr[8];           /* $5120–$5127 */
-static uint16 chr_bg[4];            /* $5128–$512B */
+static NES_LOCAL uint8 prg_reg[4];            /* $5114–$5117 */
+static NES_LOCAL uint16 chr_spr[8];           /* $5120–$5127 */
+static NES_LOCAL uint16 chr_bg[4];            /* $5128–$512B */
 
 /* ExRAM and nametable fill handling */
-static uint8 exram[0x400];
-static uint8 exram_mode;            /* lower 2 bits of $5104 */
-static uint8 nt_fill = 0;           /* $5106 */
-static uint8 at_fill = 0;           /* $5107 */
-static uint8 fill_ram[0x400];       /* prebuilt fill nametable */
-static uint8 *nt_page[4];           /* backup of CIRAM pages */
+static NES_LOCAL uint8 exram[0x400];
+static NES_LOCAL uint8 exram_mode;            /* lower 2 bits of $5104 */
+static NES_LOCAL uint8 nt_fill = 0;           /* $5106 */
+static NES_LOCAL uint8 at_fill = 0;           /* $5107 */
+static NES_LOCAL uint8 fill_ram[0x400];       /* prebuilt fill nametable */
+static NES_LOCAL uint8 *nt_page[4];           /* backup of CIRAM pages */
 
 /* Split screen registers ($5200–$5202) – stored for the PPU core */
-static uint8 split_ctrl, split_scroll, split_bank;
+static NES_LOCAL uint8 split_ctrl, split_scroll, split_bank;
 
 /* Hardware multiplier */
-static uint8 mul[2];                /* $5205/$5206 */
+static NES_LOCAL uint8 mul[2];                /* $5205/$5206 */
 
 /* IRQ counter */
-static struct {
+static NES_LOCAL struct {
     int counter;
     int latch;
     bool enabled;
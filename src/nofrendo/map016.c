@@ -28,7 +28,7 @@
 #include "new_ppu.h"
 #include "nes.h"
 
-static struct
+static NES_LOCAL struct
 {
    int counter;
    bool enabled;
@@ -46,7 +46,7 @@ do { \
    mmc_bankvrom(1, (bank) << 10, (highnybbles[(bank)] << 4)+lownybbles[(bank)]); \
 }
 
-static struct
+static NES_LOCAL struct
 {
    int counter, enabled;
    uint8 nybbles[4];
@@ -58,10 +58,10 @@ static void map18_init(void)
    irq.counter = irq.enabled = 0;
 }
 
-static uint8 lownybbles[8];
-static uint8 highnybbles[8];
-static uint8 lowprgnybbles[3];
-static uint8 highprgnybbles[3];
+static NES_LOCAL uint8 lownybbles[8];
+static NES_LOCAL uint8 highnybbles[8];
+static NES_LOCAL uint8 lowprgnybbles[3];
+static NES_LOCAL uint8 highprgnybbles[3];
 
 
 static void map18_write(uint32 address, uint8 value)
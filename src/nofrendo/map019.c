@@ -42,7 +42,7 @@
    ppu_mirrorhipages(); \
 }
 
-static struct
+static NES_LOCAL struct
 {
    int counter, enabled;
 } irq;
@@ -27,7 +27,7 @@
 #include "nes_mmc.h"
 #include "new_ppu.h"
 
-static int select_c000 = 0;
+static NES_LOCAL int select_c000 = 0;
 
 /* mapper 32: Irem G-101 */
 static void map32_write(uint32 address, uint8 value)
@@ -32,7 +32,7 @@
 #include "libsnss.h"
 #include "log.h"
 
-static struct
+static NES_LOCAL struct
 {
   bool enabled;
   uint32 counter;
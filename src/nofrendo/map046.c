@@ -32,10 +32,10 @@
 #include "libsnss.h"
 #include "log.h"
 
-static uint8 prg_low_bank;
-static uint8 chr_low_bank;
-static uint8 prg_high_bank;
-static uint8 chr_high_bank;
+static NES_LOCAL uint8 prg_low_bank;
+static NES_LOCAL uint8 chr_low_bank;
+static NES_LOCAL uint8 prg_high_bank;
+static NES_LOCAL uint8 chr_high_bank;
 
 /*************************************************/
 /* Set banks from the combined register values   */
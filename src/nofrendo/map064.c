@@ -28,14 +28,14 @@
 #include "nes.h"
 #include "log.h"
 
-static struct
+static NES_LOCAL struct
 {
    int counter, latch;
    bool enabled, reset;
 } irq;
 
-static uint8 command = 0;
-static uint16 vrombase = 0x0000;
+static NES_LOCAL uint8 command = 0;
+static NES_LOCAL uint16 vrombase = 0x0000;
 
 static void map64_hblank(int vblank)
 {
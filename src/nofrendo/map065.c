@@ -28,7 +28,7 @@
 #include "nes.h"
 #include "new_ppu.h"
 
-static struct
+static NES_LOCAL struct
 {
    int counter;
    bool enabled;
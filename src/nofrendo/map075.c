@@ -28,8 +28,8 @@
 #include "new_ppu.h"
 
 
-static uint8 latch[2];
-static uint8 hibits;
+static NES_LOCAL uint8 latch[2];
+static NES_LOCAL uint8 hibits;
 
 /* mapper 75: Konami VRC1 */
 static void map75_write(uint32 address, uint8 value)
@@ -37,15 +37,15 @@
    mmc_bankvrom(1, (bank) << 10, (highnybbles[(bank)] << 4)+lownybbles[(bank)]); \
 }
 
-static struct
+static NES_LOCAL struct
 {
    int counter, enabled;
    int latch, wait_state;
 } irq;
 
-static int select_c000 = 0;
-static uint8 lownybbles[8];
-static uint8 highnybbles[8];
+static NES_LOCAL int select_c000 = 0;
+static NES_LOCAL uint8 lownybbles[8];
+static NES_LOCAL uint8 highnybbles[8];
 
 static void vrc_init(void)
 {
@@ -34,8 +34,8 @@
 #define  APU_VOLUME_DECAY(x)  ((x) -= ((x) >> 7))
 
 /* look up table madness */
-static int32 decay_lut[16];
-static int vbl_lut[32];
+static NES_LOCAL int32 decay_lut[16];
+static NES_LOCAL int vbl_lut[32];
 
 /* various sound constants for sound emulation */
 /* vblank length table used for rectangles, triangle, noise */
@@ -94,7 +94,7 @@ typedef struct mmc5dac_s
 } mmc5dac_t;
 
 
-static struct
+static NES_LOCAL struct
 {
    float incsize;
    uint8 mul[2];
@@ -48,6 +48,7 @@
 #include "nes_mmc.h"
 #include "vid_drv.h"
 #include "nofrendo.h"
+#include "wram.h"
 
 /* Forward declaration from nes_ppu.c */
 void ppu_step_one_cpu_cycle(void);
@@ -68,7 +69,7 @@ void ppu_step_one_cpu_cycle(void);
 
 /* PPU_PER_CPU constant removed - now handled by catch-up scheduler */
 
-static nes_t nes;
+static NES_LOCAL nes_t nes;
 
 int nes_isourfile(const char *filename)
 {
@@ -106,6 +107,7 @@ static uint8 ram_read(uint32 address);
 static void ram_write(uint32 address, uint8 value);
 static uint8 io_read(uint32 address);
 static void io_write(uint32 address, uint8 value);
+static void fiq_write(uint32 address, uint8 value);
 
 #define LAST_MEMORY_HANDLER   { -1, -1, NULL }
 
@@ -126,7 +128,7 @@ static nes6502_memwrite default_writehandler[] =
    { 0x4015, 0x4015, apu_write     },
    { 0x4014, 0x4014, ppu_writehigh },
    { 0x4016, 0x4016, io_write      },
-   { 0x4017, 0x4017, apu_write     },
+   { 0x4017, 0x4017, fiq_write     },
    LAST_MEMORY_HANDLER
 };
 
@@ -173,6 +175,8 @@ static void build_address_handlers(nes_t *machine)
       machine->writehandler[num_handlers].min_range = 0xFFFFFFFF;
       machine->writehandler[num_handlers].max_range = 0xFFFFFFFF;
       machine->writehandler[num_handlers].write_func = NULL;
+
+      nes_compilememmap(machine);
       return;
    }
    
@@ -187,7 +191,7 @@ static void build_address_handlers(nes_t *machine)
    }
 
    /* Add MMC-specific read handlers - with safe bounds checking */
-   for (count = 0; count < MAX_MEM_HANDLERS && num_handlers < MAX_MEM_HANDLERS - 1; count++) {
+   for (count = 0; intf->mem_read && count < MAX_MEM_HANDLERS && num_handlers < MAX_MEM_HANDLERS - 1; count++) {
       if (NULL == intf->mem_read[count].read_func)
          break;
       machine->readhandler[num_handlers].min_range = intf->mem_read[count].min_range;
@@ -210,7 +214,7 @@ static void build_address_handlers(nes_t *machine)
    }
 
    /* Add MMC-specific write handlers - with safe bounds checking */
-   for (count = 0; count < MAX_MEM_HANDLERS && num_handlers < MAX_MEM_HANDLERS - 1; count++) {
+   for (count = 0; intf->mem_write && count < MAX_MEM_HANDLERS && num_handlers < MAX_MEM_HANDLERS - 1; count++) {
       if (NULL == intf->mem_write[count].write_func)
          break;
       machine->writehandler[num_handlers].min_range = intf->mem_write[count].min_range;
@@ -222,6 +226,56 @@ static void build_address_handlers(nes_t *machine)
    machine->writehandler[num_handlers].min_range = 0xFFFFFFFF;
    machine->writehandler[num_handlers].max_range = 0xFFFFFFFF;
    machine->writehandler[num_handlers].write_func = NULL;
+
+   nes_compilememmap(machine);
+}
+
+/* Compile the handler lists into the per-page dispatch table the CPU
+** uses for $0800-$7FFF.  The first handler touching a page owns it if
+** it covers the whole page; otherwise the page is marked for the linear
+** scan, which keeps the first-match semantics of the handler lists.
+*/
+void nes_compilememmap(nes_t *machine)
+{
+   nes6502_memread *mr;
+   nes6502_memwrite *mw;
+   nes6502_memmap *mm;
+   uint32 page, lo, hi;
+
+   for (page = 0; page < NES6502_NUMPAGES; page++)
+   {
+      mm = &machine->memmap[page];
+      memset(mm, 0, sizeof(nes6502_memmap));
+      lo = page << NES6502_PAGESHIFT;
+      hi = lo + NES6502_PAGESIZE - 1;
+
+      for (mr = machine->readhandler; mr->min_range != 0xFFFFFFFF; mr++)
+      {
+         if (mr->max_range < lo || mr->min_range > hi)
+            continue;
+         if (mr->min_range <= lo && mr->max_range >= hi)
+            mm->read_func = mr->read_func;
+         else
+            mm->read_scan = 1;
+         break;
+      }
+
+      for (mw = machine->writehandler; mw->min_range != 0xFFFFFFFF; mw++)
+      {
+         if (mw->max_range < lo || mw->min_range > hi)
+            continue;
+         if (mw->min_range <= lo && mw->max_range >= hi)
+            mm->write_func = mw->write_func;
+         else
+            mm->write_scan = 1;
+         break;
+      }
+
+      /* handlers above the RAM mirrors belong to registers of some device */
+      if (page >= (0x2000 >> NES6502_PAGESHIFT)
+          && (mm->read_func || mm->write_func || mm->read_scan || mm->write_scan))
+         mm->sync = 1;
+   }
 }
 
 static uint8 ram_read(uint32 address)
@@ -247,9 +301,9 @@ static void write_protect(uint32 address, uint8 value)
 }
 
 /* -------- Controller I/O ($4016/$4017) -------- */
-static uint8 joy_state[2] = {0, 0};   /* platform input should set these (1=pressed per bit A,B,Select,Start,Up,Down,Left,Right) */
-static uint8 joy_shift[2] = {0, 0};
-static uint8 joy_strobe   = 0;
+static NES_LOCAL uint8 joy_state[2] = {0, 0};   /* platform input should set these (1=pressed per bit A,B,Select,Start,Up,Down,Left,Right) */
+static NES_LOCAL uint8 joy_shift[2] = {0, 0};
+static NES_LOCAL uint8 joy_strobe   = 0;
 
 /* Optional: expose a setter the platform layer can call after osd_getinput() */
 void nes_set_joy_state(int port, uint8 state) {
@@ -306,24 +360,30 @@ static uint8 nes_clearfiq(void)
 void nes_setfiq(uint8 value)
 {
    nes.fiq_state = value;
-   nes.fiq_cycles = (int) NES_FIQ_PERIOD;
+   nes.fiq_deadline = nes.sync_cycles + NES_FIQ_PERIOD;
+
+   /* setting the inhibit bit also acknowledges a pending frame IRQ */
+   if (value & 0x40)
+      nes.fiq_occurred = false;
 }
 
-static void nes_checkfiq(int cycles_delta)
+/* $4017: frame counter mode and IRQ inhibit */
+static void fiq_write(uint32 address, uint8 value)
 {
-   while (cycles_delta > 0) {
-      int cycles_to_process = (cycles_delta < nes.fiq_cycles) ? cycles_delta : nes.fiq_cycles;
-      nes.fiq_cycles -= cycles_to_process;
-      cycles_delta -= cycles_to_process;
-      
-      if (nes.fiq_cycles <= 0)
+   UNUSED(address);
+   nes_setfiq(value);
+}
+
+/* Fire the frame IRQ for each deadline the machine has been caught up past */
+static void nes_checkfiq(void)
+{
+   while ((int32) (nes.sync_cycles - nes.fiq_deadline) >= 0)
+   {
+      nes.fiq_deadline += NES_FIQ_PERIOD;
+      if (0 == (nes.fiq_state & 0xC0))
       {
-         nes.fiq_cycles += (int) NES_FIQ_PERIOD;
-         if (0 == (nes.fiq_state & 0xC0))
-         {
-            nes.fiq_occurred = true;
-            nes6502_irq();
-         }
+         nes.fiq_occurred = true;
+         nes6502_irq();
       }
    }
 }
@@ -353,8 +413,336 @@ void nes_poweroff(void)
 /* Advance the PPU by the given number of CPU cycles */
 static void ppu_catchup(int cycles)
 {
-   for (int i = 0; i < cycles; ++i)
-      ppu_step_one_cpu_cycle();
+   ppu_run(cycles);
+}
+
+/* ──────────────────────────────────────────────────────────────
+ * Event-driven scheduling
+ *
+ * The CPU runs ahead of the rest of the machine in timeslices that
+ * end on the next cycle anything can interrupt it: NMI, the end of
+ * the frame, an A12 mapper clock on a rendered line, or the APU frame
+ * IRQ.  Register pages in the memory map are flagged so that the core
+ * calls back before touching them; the PPU, M2 counter and frame IRQ
+ * are then caught up to the start of that instruction and the slice
+ * ends after it, so every device still sees accesses at the cycle the
+ * per-instruction loop showed them.
+ * ────────────────────────────────────────────────────────────── */
+
+/* Bring the PPU, MMC3 M2 counter and frame IRQ up to the CPU */
+static void nes_sync(void)
+{
+   int cycles = (int) (nes6502_getcycles(false) - nes.sync_cycles);
+
+   if (cycles <= 0)
+      return;
+
+   nes.sync_cycles += cycles;
+   nes.cpu_cycles_total += cycles;
+   ppu_mmc3_m2_tick(cycles);
+   ppu_catchup(cycles);
+   nes_checkfiq();
+}
+
+/* A DMA stalls the CPU for cycles the PPU has already been run through:
+** count them as synced, so nes_sync doesn't run them a second time once
+** the core burns them
+*/
+void nes_dmaburn(int cycles)
+{
+   nes.sync_cycles += cycles;
+   nes.cpu_cycles_total += cycles;
+   nes_checkfiq();
+   nes6502_burn(cycles);
+   nes6502_release();
+}
+
+/* The core is about to touch a register: catch up and end the slice */
+static void nes_iosync(void)
+{
+   nes_sync();
+   nes6502_release();
+}
+
+/* Per-cycle core: keep the machine in lockstep with every bus cycle */
+static void nes_bushook(uint32 address, uint8 value, int write)
+{
+   UNUSED(address);
+   UNUSED(value);
+   UNUSED(write);
+
+   nes_sync();
+}
+
+/* How far the CPU may run before something can interrupt it */
+static int nes_horizon(void)
+{
+   int cycles = ppu_cycles_to_event();
+   int fiq = (int32) (nes.fiq_deadline - nes.sync_cycles);
+   int owed = (int32) (nes.sync_cycles - nes6502_getcycles(false));
+
+   if (0 == (nes.fiq_state & 0xC0) && fiq < cycles)
+      cycles = fiq;
+   if (cycles < 1)
+      cycles = 1;
+
+   /* a DMA the machine ran ahead through is burnt first */
+   return (owed > 0) ? owed + cycles : cycles;
+}
+
+/* ──────────────────────────────────────────────────────────────
+ * Idle-loop fast-forward
+ *
+ * Games waiting for NMI spin in `JMP *` or in a load/branch pair
+ * polling PPUSTATUS or memory (`LDA $2002 / BPL`, `LDA flag / BEQ`).
+ * Once one real iteration has run, every further iteration whose load
+ * would leave the registers and flags as the real one did leaves the
+ * CPU exactly as it found it, so the core is stepped over it and only
+ * the cycles are accounted.  The skipped cycles stay inside the
+ * scheduler's timeslice, so timing and interrupts come out identical.
+ * ────────────────────────────────────────────────────────────── */
+enum
+{
+   IDLE_NONE,     /* no loop, or waiting for a real iteration */
+   IDLE_ARMED,    /* next instruction is the loop head */
+   IDLE_BRANCH    /* load was skipped, next is the branch back */
+};
+
+enum
+{
+   POLL_NONE,     /* JMP * */
+   POLL_MEMORY,   /* RAM, WRAM or ROM */
+   POLL_STATUS    /* PPUSTATUS */
+};
+
+enum
+{
+   LOAD_A,        /* LDA */
+   LOAD_X,        /* LDX */
+   LOAD_Y,        /* LDY */
+   LOAD_BIT       /* BIT: only N, V and Z */
+};
+
+static NES_LOCAL struct
+{
+   int state, poll, load;
+   uint32 load_pc, branch_pc;
+   uint32 addr;
+   uint8 value;      /* register the real load left, A for BIT */
+   uint8 flags;      /* N, V and Z the real BIT left */
+   int load_cycles, branch_cycles;
+   uint32 hist[2];   /* PCs of the last two single-stepped instructions */
+} idle;
+
+#define  IDLE_NOPC   0x10000   /* outside the 6502 address space */
+
+/* read the polled location without side effects */
+static uint8 idle_peek(void)
+{
+   if (idle.addr < 0x2000)
+      return nes.cpu->mem_page[0][idle.addr & (NES_RAMSIZE - 1)];
+   return nes6502_getbyte(idle.addr);
+}
+
+/* record what the real load left in the CPU, once its loop is armed */
+static void idle_latch(void)
+{
+   nes6502_context cpu;
+
+   nes6502_getcontext(&cpu);
+   switch (idle.load)
+   {
+   case LOAD_X:
+      idle.value = cpu.x_reg;
+      break;
+
+   case LOAD_Y:
+      idle.value = cpu.y_reg;
+      break;
+
+   default:
+      idle.value = cpu.a_reg;
+      break;
+   }
+   idle.flags = cpu.p_reg & (N_FLAG | V_FLAG | Z_FLAG);
+}
+
+/* true if the loop's load would leave the CPU as the real one did */
+static bool idle_stable(void)
+{
+   uint8 value;
+
+   switch (idle.poll)
+   {
+   case POLL_STATUS:
+      if (false == ppu_peekstatus(&value))
+         return false;
+      break;
+
+   case POLL_MEMORY:
+      value = idle_peek();
+      break;
+
+   default:
+      return true;
+   }
+
+   if (LOAD_BIT == idle.load)
+      return idle.flags == ((value & (N_FLAG | V_FLAG))
+                            | ((value & idle.value) ? 0 : Z_FLAG));
+   return value == idle.value;
+}
+
+/* decode a side-effect-free loop starting at pc */
+static bool idle_decode(uint32 pc)
+{
+   uint8 op = nes6502_getbyte(pc);
+   uint32 branch, target;
+   int len;
+
+   if (0x4C == op)
+   {
+      /* JMP * */
+      if (pc != (nes6502_getbyte(pc + 1) | (nes6502_getbyte(pc + 2) << 8)))
+         return false;
+      idle.poll = POLL_NONE;
+      idle.load_pc = idle.branch_pc = pc;
+      idle.load_cycles = 3;
+      return true;
+   }
+
+   switch (op)
+   {
+   case 0xA5: case 0xA6: case 0xA4: case 0x24:  /* LDA/LDX/LDY/BIT $nn */
+      idle.addr = nes6502_getbyte(pc + 1);
+      idle.load_cycles = 3;
+      len = 2;
+      break;
+
+   case 0xAD: case 0xAE: case 0xAC: case 0x2C:  /* LDA/LDX/LDY/BIT $nnnn */
+      idle.addr = nes6502_getbyte(pc + 1) | (nes6502_getbyte(pc + 2) << 8);
+      idle.load_cycles = 4;
+      len = 3;
+      break;
+
+   default:
+      return false;
+   }
+
+   switch (op & 0xE3)
+   {
+   case 0xA1: idle.load = LOAD_A;   break;
+   case 0xA2: idle.load = LOAD_X;   break;
+   case 0xA0: idle.load = LOAD_Y;   break;
+   default:   idle.load = LOAD_BIT; break;
+   }
+
+   /* only plain memory or PPUSTATUS: other registers have side effects */
+   if (idle.addr < 0x2000 || idle.addr >= 0x8000)
+      idle.poll = POLL_MEMORY;
+   else if (idle.addr < 0x4000 && PPU_STAT == (idle.addr & 0x2007))
+      idle.poll = POLL_STATUS;
+   else if (idle.addr >= 0x6000 && NULL == nes.memmap[idle.addr >> NES6502_PAGESHIFT].read_func
+            && 0 == nes.memmap[idle.addr >> NES6502_PAGESHIFT].read_scan)
+      idle.poll = POLL_MEMORY;
+   else
+      return false;
+
+   /* followed by a conditional branch back to the load */
+   branch = (pc + len) & 0xFFFF;
+   if (0x10 != (nes6502_getbyte(branch) & 0x1F))
+      return false;
+   op = nes6502_getbyte(branch + 1);
+   target = (branch + 2 + (int8) op) & 0xFFFF;
+   if (target != pc)
+      return false;
+
+   idle.load_pc = pc;
+   idle.branch_pc = branch;
+   idle.branch_cycles = 3;
+   if (((int8) op + ((branch + 2) & 0x00FF)) & 0x100)
+      idle.branch_cycles++;
+   return true;
+}
+
+/* true if pc is the load or the branch of a loop idle_decode accepts */
+static bool idle_candidate(uint32 pc)
+{
+   uint8 op = nes6502_getbyte(pc);
+
+   if (0x10 == (op & 0x1F))
+      return idle_decode((pc + 2 + (int8) nes6502_getbyte(pc + 1)) & 0xFFFF)
+             && idle.branch_pc == pc;
+
+   return idle_decode(pc);
+}
+
+/* Step over idle-loop instructions if possible; returns the cycles
+ * accounted, or zero if the CPU core has to run.  Memory polls are
+ * stepped over until the slice is used up; PPUSTATUS polls one
+ * instruction at a time, since the PPU has to be caught up before
+ * each peek.  Near a loop the slice is cut to a single instruction,
+ * so the real iteration that arms it is seen.
+ */
+static int idle_step(int *slice)
+{
+   uint32 pc = nes6502_getpc();
+   int cycles = 0, step = 1;
+
+   /* a loop is armed once one full iteration ran for real */
+   if (IDLE_NONE == idle.state && (pc == idle.hist[0] || pc == idle.hist[1]))
+   {
+      if (idle_decode(pc) && idle.hist[0] == idle.branch_pc
+          && (idle.branch_pc == pc || idle.hist[1] == pc))
+      {
+         idle.state = IDLE_ARMED;
+         if (POLL_NONE != idle.poll)
+            idle_latch();
+      }
+   }
+
+   while (step && cycles < *slice)
+   {
+      step = 0;
+      if (IDLE_ARMED == idle.state && pc == idle.load_pc && idle_stable())
+      {
+         step = nes6502_idle(idle.branch_pc, idle.load_cycles);
+         if (step && idle.branch_pc != idle.load_pc)
+            idle.state = IDLE_BRANCH;
+      }
+      else if (IDLE_BRANCH == idle.state && pc == idle.branch_pc)
+      {
+         step = nes6502_idle(idle.load_pc, idle.branch_cycles);
+         if (step)
+            idle.state = IDLE_ARMED;
+      }
+      pc = nes6502_getpc();
+      cycles += step;
+
+      if (POLL_STATUS == idle.poll)
+         break;
+   }
+
+   if (cycles)
+   {
+      nes.idle_cycles += cycles;
+      nes.idle_cycles_total += cycles;
+      return cycles;
+   }
+
+   /* the real core runs this one; one instruction at a time near a loop */
+   idle.state = IDLE_NONE;
+   if (idle_candidate(pc))
+   {
+      *slice = 1;
+      idle.hist[1] = idle.hist[0];
+      idle.hist[0] = pc;
+   }
+   else
+   {
+      idle.hist[0] = idle.hist[1] = IDLE_NOPC;
+   }
+   return 0;
 }
 
 /* ──────────────────────────────────────────────────────────────
@@ -371,18 +759,18 @@ void nes_renderframe(bool draw_flag)
    mapintf_t *mapintf = nes.mmc->intf;
    bool frame_done = false;
 
+   nes.idle_cycles = 0;
+
    /* Run until PPU signals actual frame completion (handles variable 89341/89342 cycle frames) */
    while (!frame_done)
    {
-      /* Execute CPU instruction */
-      int cpu_cycles = nes6502_execute(1);
-      nes.cpu_cycles_total += cpu_cycles;
-      /* Advance MMC3 M2 counter and PPU timing */
-      ppu_mmc3_m2_tick(cpu_cycles);
-      ppu_catchup(cpu_cycles);
+      /* Run the CPU up to the next event, or step over an idle loop */
+      int slice = nes_horizon();
+      if (0 == idle_step(&slice))
+         nes6502_execute(slice);
 
-      /* APU frame-IRQ advancement in CPU stepping path */
-      nes_checkfiq(cpu_cycles);
+      /* Advance MMC3 M2 counter, PPU timing and frame IRQ to match */
+      nes_sync();
 
       /* Check frame completion only once per iteration to avoid race conditions */
       frame_done = ppu_frame_complete();
@@ -416,7 +804,7 @@ void nes_emulate(void)
 
    last_ticks = nofrendo_ticks;
    frames_to_render = 0;
-   nes.fiq_cycles = (int) NES_FIQ_PERIOD;
+   nes.fiq_deadline = nes.sync_cycles + NES_FIQ_PERIOD;
 
    while (false == nes.poweroff)
    {
@@ -466,6 +854,15 @@ void nes_emulate(void)
    }
 }
 
+/* rand() for this machine alone: newlib's LCG, so a seeded machine
+** draws what the single-machine build drew from rand() on the ESP32
+*/
+int nes_random(void)
+{
+   nes.rand_state = nes.rand_state * 6364136223846793005ULL + 1;
+   return (int) ((nes.rand_state >> 32) & 0x7FFFFFFF);
+}
+
 static void mem_trash(uint8 *buffer, int length)
 {
    int i;
@@ -473,7 +870,7 @@ static void mem_trash(uint8 *buffer, int length)
    ASSERT(buffer);
 
    for (i = 0; i < length; i++)
-      buffer[i] = rand();
+      buffer[i] = nes_random();
 }
 
 /* Reset NES hardware */
@@ -499,26 +896,33 @@ void nes_reset(int reset_type)
    }
 
    nes6502_reset();
+   nes.sync_cycles = nes6502_getcycles(false);
 
    nes.fiq_occurred = false;
    nes.fiq_state = 0;
-   nes.fiq_cycles = (int) NES_FIQ_PERIOD;
+   nes.fiq_deadline = nes.sync_cycles + NES_FIQ_PERIOD;
    nes.pal_fractional_acc = 0;
    /* Legacy scanline timing removed - now handled by cycle-accurate PPU */
 }
 
 static int nes_init(void)
 {
+   sndinfo_t osd_sound;
    int error;
 
    /* allocate our main structs */
+   osd_getsoundinfo(&osd_sound);
    nes.cpu = malloc(sizeof(nes6502_context));
    nes.ppu = ppu_create();
-   nes.apu = malloc(sizeof(apu_t));
+   nes.apu = apu_create(0, osd_sound.sample_rate, NES_REFRESH_RATE, osd_sound.bps);
    nes.mmc = malloc(sizeof(mmc_t));
    if (NULL == nes.cpu || NULL == nes.apu || NULL == nes.mmc)
       return NESERR_OUT_OF_MEMORY;
 
+   /* $4015 reads acknowledge the frame IRQ */
+   nes.apu->irqclear_callback = nes_clearfiq;
+   apu_setcontext(nes.apu);
+
    /* Initialize CPU context */
    memset(nes.cpu, 0, sizeof(nes6502_context));
 
@@ -538,10 +942,8 @@ static int nes_init(void)
    
    nes.cpu->read_handler = nes.readhandler;
    nes.cpu->write_handler = nes.writehandler;
-
-   /* Initialize APU */
-   if (0 != (error = apu_init(nes.apu, NULL)))
-      return error;
+   nes.cpu->mem_map = nes.memmap;
+   nes.cpu->sync_func = nes_iosync;
 
    if (0 != (error = mmc_init(nes.mmc)))
       return error;
@@ -560,10 +962,11 @@ static int nes_init(void)
    nes.scanline = 0;
    nes.fiq_occurred = false;
    nes.fiq_state = 0;
-   nes.fiq_cycles = (int) NES_FIQ_PERIOD;
+   nes.fiq_deadline = nes.sync_cycles + NES_FIQ_PERIOD;
    
    /* Initialize global cycle counters */
    nes.cpu_cycles_total = 0;
+   nes.idle_cycles_total = 0;
    nes.ppu_cycles_total = 0;
    nes.last_catchup_cpu_cycles = 0;
    nes.is_pal_region = false;  /* Default to NTSC, can be overridden */
@@ -575,6 +978,8 @@ nes_t *nes_create(void)
 {
    int error;
 
+   /* seeded before nes_init, whose ppu_create draws the power-up status */
+   nes.rand_state = 1;
    if (0 != (error = nes_init()))
       return NULL;
 
@@ -583,6 +988,26 @@ nes_t *nes_create(void)
    return &nes;
 }
 
+/* Log whichever CPU profiles are compiled in for the outgoing cart */
+static void nes_dumpprofiles(rominfo_t *rominfo)
+{
+   /* share of the run the idle-loop skip stepped over */
+   if (nes.cpu_cycles_total)
+   {
+      uint32 bp = (uint32) (nes.idle_cycles_total * 10000 / nes.cpu_cycles_total);
+      log_printf("idle skip: %s, %u.%02u%% of %llu cycles\n", rominfo->filename,
+                 bp / 100, bp % 100, (unsigned long long) nes.cpu_cycles_total);
+   }
+#ifdef NES6502_OPSTATS
+   nes6502_dumpopstats(rominfo->filename);
+#endif /* NES6502_OPSTATS */
+#ifdef NES6502_PCPROF
+   nes6502_dumpprofile(rominfo->filename, rominfo->rom,
+                       rominfo->rom_banks * 0x4000);
+#endif /* NES6502_PCPROF */
+   UNUSED(rominfo);
+}
+
 void nes_destroy(nes_t **machine)
 {
    if (machine && *machine) {
@@ -599,7 +1024,10 @@ void nes_destroy(nes_t **machine)
       }
 
       if ((*machine)->rominfo)
+      {
+         nes_dumpprofiles((*machine)->rominfo);
          rom_freeinfo((*machine)->rominfo, (*machine)->ppu);
+      }
 
       memset(*machine, 0, sizeof(nes_t));
       *machine = NULL;
@@ -608,11 +1036,15 @@ void nes_destroy(nes_t **machine)
 
 int nes_insertcart(const char *filename, nes_t *machine)
 {
+   nes6502_context live;
    int error;
    nes_t *nes_ptr = machine ? machine : &nes;
 
    if (NULL != nes_ptr->rominfo)
+   {
+      nes_dumpprofiles(nes_ptr->rominfo);
       rom_freeinfo(nes_ptr->rominfo, nes_ptr->ppu);
+   }
 
    if (NULL == (nes_ptr->rominfo = rom_load(filename)))
       return NESERR_BAD_FILE;
@@ -620,6 +1052,19 @@ int nes_insertcart(const char *filename, nes_t *machine)
    if (0 != (error = mmc_setcart(nes_ptr)))
       return error;
 
+   /* pick up the mapper's register handlers, then the WRAM gate */
+   build_address_handlers(nes_ptr);
+   wram_init(nes_ptr);
+
+   /* the ROM database picks the CPU core; the running one keeps its
+   ** own copy of the context
+   */
+   nes_ptr->cpu->bus_hook = (nes_ptr->rominfo->flags & ROM_FLAG_BUSCYCLE)
+                            ? nes_bushook : NULL;
+   nes6502_getcontext(&live);
+   live.bus_hook = nes_ptr->cpu->bus_hook;
+   nes6502_setcontext(&live);
+
    nes_reset(HARD_RESET);
 
    return 0;
@@ -63,6 +63,7 @@ typedef struct nes_s
    nes6502_context *cpu;
    nes6502_memread readhandler[MAX_MEM_HANDLERS];
    nes6502_memwrite writehandler[MAX_MEM_HANDLERS];
+   nes6502_memmap memmap[NES6502_NUMPAGES];
 
    ppu_t *ppu;
    apu_t *apu;
@@ -77,7 +78,7 @@ typedef struct nes_s
 
    bool fiq_occurred;
    uint8 fiq_state;
-   int fiq_cycles;
+   uint32 fiq_deadline;               /* CPU cycle of the next frame IRQ tick */
 
    int scanline;
 
@@ -91,6 +92,15 @@ typedef struct nes_s
    uint64_t last_catchup_cpu_cycles;  /* For delta-based PAL calculation */
    bool is_pal_region;
    uint64_t pal_fractional_acc;
+   uint32 sync_cycles;                /* CPU cycle the machine is caught up to */
+
+   /* CPU cycles fast-forwarded through idle loops in the last frame,
+    * and since reset (logged per cart next to cpu_cycles_total) */
+   int idle_cycles;
+   uint64_t idle_cycles_total;
+
+   /* power-up noise generator, so each machine draws its own sequence */
+   uint64_t rand_state;
 
    /* control */
    bool poweroff;
@@ -111,7 +121,10 @@ extern void nes_setcontext(nes_t *machine);
 extern nes_t *nes_create(void);
 extern void nes_destroy(nes_t **machine);
 extern int nes_insertcart(const char *filename, nes_t *machine);
+extern void nes_compilememmap(nes_t *machine);
 
+extern int nes_random(void);
+extern void nes_dmaburn(int cycles);
 extern void nes_setfiq(uint8 state);
 extern void nes_nmi(void);
 extern void nes_irq(void);
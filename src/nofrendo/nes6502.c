@@ -24,14 +24,17 @@
 */
 
 
+#include <string.h>
 #include "noftypes.h"
 #include "nes6502.h"
 //#include "dis6502.h"
-uint8 ext_irq_line = 0;
+NES_LOCAL uint8 ext_irq_line = 0;
 
 /* Internal CPU context and cycle bookkeeping */
-static nes6502_context cpu;
-static int remaining_cycles = 0; /* so we can release timeslice */
+static NES_LOCAL nes6502_context cpu;
+static NES_LOCAL int remaining_cycles = 0; /* so we can release timeslice */
+static NES_LOCAL bool executing = false; /* registers are held in locals */
+static NES_LOCAL bool nmi_deferred = false, irq_deferred = false;
 
 /* Advance the CPU by n cycles (PPU stepped externally) */
 static inline void cpu_advance_cycles(int n) {
@@ -41,9 +44,33 @@ static inline void cpu_advance_cycles(int n) {
 
 //#define  NES6502_DISASM
 
-#ifdef __GNUC__
+/* Threaded dispatch: every opcode handler ends in its own computed
+** goto through opcode_table, instead of looping back to one shared
+** switch.  Needs GCC's labels-as-values; define NES6502_SWITCH to
+** build the portable switch version anyway (e.g. to compare the two).
+*/
+#if defined(__GNUC__) && !defined(NES6502_SWITCH)
 #define  NES6502_JUMPTABLE
-#endif /* __GNUC__ */
+#endif /* __GNUC__ && !NES6502_SWITCH */
+
+/* Cache decoded PRG-ROM instructions (opcode + operand).  Entries are
+** keyed by the host address of the opcode byte, so a bankswitch simply
+** makes the old entries unreachable; code below $8000 (RAM/WRAM) is
+** always decoded afresh.  Build with NES6502_DCACHE=0 to decode every
+** instruction as it is fetched.
+*/
+#ifndef NES6502_DCACHE
+#define  NES6502_DCACHE       1
+#endif /* !NES6502_DCACHE */
+#ifndef NES6502_DCACHE_SIZE
+#define  NES6502_DCACHE_SIZE  1024 /* entries, must be a power of two */
+#endif /* !NES6502_DCACHE_SIZE */
+
+/* Also build the per-cycle core, which reports every bus access to
+** cpu.bus_hook as it happens.  It only runs while a hook is installed,
+** so games that don't need one never leave the batched core.
+*/
+#define  NES6502_BUSHOOK
 
 
 #define  ADD_CYCLES(x) \
@@ -60,6 +87,26 @@ do { \
       ADD_CYCLES(1); \
 }
 
+/* Address before the carry out of an index addition reached the high
+** byte: the 6502 reads from here while it fixes the address up
+*/
+#define UNFIXED_ADDR(addr, reg) \
+   (((addr) - (((reg) > (uint8) (addr)) ? 0x100 : 0)) & 0xFFFF)
+
+/* Bus cycles that don't contribute to the result.  The batched core
+** leaves them out; the per-cycle core redefines them as real accesses.
+*/
+#define DUMMY_READ(addr)                     ((void) 0)
+#define ZP_DUMMY_READ(addr)                  ((void) 0)
+#define DUMMY_WRITE(write_func, addr, value) ((void) 0)
+
+/* Read instructions only fix up the address when they cross a page */
+#define PAGE_CROSS_READ(addr, reg) \
+{ \
+   if ((reg) > (uint8) (addr)) \
+      DUMMY_READ(UNFIXED_ADDR(addr, reg)); \
+}
+
 #define EMPTY_READ(value)  /* empty */
 
 /*
@@ -69,13 +116,14 @@ do { \
 /* Immediate */
 #define IMMEDIATE_BYTE(value) \
 { \
-   value = bank_readbyte(PC++); \
+   value = OPERAND_BYTE(); \
+   PC++; \
 }
 
 /* Absolute */
 #define ABSOLUTE_ADDR(address) \
 { \
-   address = bank_readword(PC); \
+   address = OPERAND_WORD(); \
    PC += 2; \
 }
 
@@ -95,6 +143,7 @@ do { \
 { \
    ABSOLUTE_ADDR(address); \
    address = (address + X) & 0xFFFF; \
+   DUMMY_READ(UNFIXED_ADDR(address, X)); \
 }
 
 #define ABS_IND_X(address, value) \
@@ -111,9 +160,11 @@ do { \
 /* special page-cross check version for read instructions */
 #define ABS_IND_X_BYTE_READ(value) \
 { \
-   ABS_IND_X_ADDR(temp); \
-   PAGE_CROSS_CHECK(temp, X); \
+   ABSOLUTE_ADDR(temp); \
+   temp = (temp + X) & 0xFFFF; \
+   PAGE_CROSS_READ(temp, X); \
    value = mem_readbyte(temp); \
+   PAGE_CROSS_CHECK(temp, X); \
 }
 
 /* Absolute indexed Y */
@@ -121,6 +172,7 @@ do { \
 { \
    ABSOLUTE_ADDR(address); \
    address = (address + Y) & 0xFFFF; \
+   DUMMY_READ(UNFIXED_ADDR(address, Y)); \
 }
 
 #define ABS_IND_Y(address, value) \
@@ -137,9 +189,11 @@ do { \
 /* special page-cross check version for read instructions */
 #define ABS_IND_Y_BYTE_READ(value) \
 { \
-   ABS_IND_Y_ADDR(temp); \
-   PAGE_CROSS_CHECK(temp, Y); \
+   ABSOLUTE_ADDR(temp); \
+   temp = (temp + Y) & 0xFFFF; \
+   PAGE_CROSS_READ(temp, Y); \
    value = mem_readbyte(temp); \
+   PAGE_CROSS_CHECK(temp, Y); \
 }
 
 /* Zero-page */
@@ -163,6 +217,7 @@ do { \
 #define ZP_IND_X_ADDR(address) \
 { \
    ZERO_PAGE_ADDR(address); \
+   ZP_DUMMY_READ(address); \
    address += X; \
 }
 
@@ -182,6 +237,7 @@ do { \
 #define ZP_IND_Y_ADDR(address) \
 { \
    ZERO_PAGE_ADDR(address); \
+   ZP_DUMMY_READ(address); \
    address += Y; \
 }
 
@@ -195,6 +251,7 @@ do { \
 #define INDIR_X_ADDR(address) \
 { \
    ZERO_PAGE_ADDR(btemp); \
+   ZP_DUMMY_READ(btemp); \
    btemp += X; \
    address = zp_readword(btemp); \
 }
@@ -215,6 +272,7 @@ do { \
 { \
    ZERO_PAGE_ADDR(btemp); \
    address = (zp_readword(btemp) + Y) & 0xFFFF; \
+   DUMMY_READ(UNFIXED_ADDR(address, Y)); \
 }
 
 #define INDIR_Y(address, value) \
@@ -231,9 +289,11 @@ do { \
 /* special page-cross check version for read instructions */
 #define INDIR_Y_BYTE_READ(value) \
 { \
-   INDIR_Y_ADDR(temp); \
-   PAGE_CROSS_CHECK(temp, Y); \
+   ZERO_PAGE_ADDR(btemp); \
+   temp = (zp_readword(btemp) + Y) & 0xFFFF; \
+   PAGE_CROSS_READ(temp, Y); \
    value = mem_readbyte(temp); \
+   PAGE_CROSS_CHECK(temp, Y); \
 }
 
 
@@ -329,6 +389,22 @@ do { \
    JUMP(IRQ_VECTOR); \
 }
 
+/* An instruction that clears I takes an IRQ that is pending or still
+** held on the line straight away, where stepping one instruction at a
+** time would have taken it at the next instruction boundary.
+*/
+#define IRQ_UNMASKED() \
+{ \
+   if (0 == i_flag && (cpu.int_pending || ext_irq_line) \
+       && remaining_cycles > 0) \
+   { \
+      cpu.int_pending = 0; \
+      cpu.irq_was_requested = 0; \
+      IRQ_PROC(); \
+      ADD_CYCLES(INT_CYCLES); \
+   } \
+}
+
 /*
 ** Instruction macros
 */
@@ -457,6 +533,7 @@ do { \
 #define ASL(cycles, read_func, write_func, addr) \
 { \
    read_func(addr, data); \
+   DUMMY_WRITE(write_func, addr, data); \
    c_flag = data >> 7; \
    data <<= 1; \
    write_func(addr, data); \
@@ -562,12 +639,7 @@ do { \
 { \
    i_flag = 0; \
    ADD_CYCLES(2); \
-   if (cpu.int_pending && remaining_cycles > 0) \
-   { \
-      cpu.int_pending = 0; \
-      IRQ_PROC(); \
-      ADD_CYCLES(INT_CYCLES); \
-   } \
+   IRQ_UNMASKED(); \
 }
 
 #define CLV() \
@@ -609,6 +681,7 @@ do { \
 #define DCP(cycles, read_func, write_func, addr) \
 { \
    read_func(addr, data); \
+   DUMMY_WRITE(write_func, addr, data); \
    data--; \
    write_func(addr, data); \
    CMP(cycles, EMPTY_READ); \
@@ -617,6 +690,7 @@ do { \
 #define DEC(cycles, read_func, write_func, addr) \
 { \
    read_func(addr, data); \
+   DUMMY_WRITE(write_func, addr, data); \
    data--; \
    write_func(addr, data); \
    SET_NZ_FLAGS(data); \
@@ -655,6 +729,7 @@ do { \
 #define INC(cycles, read_func, write_func, addr) \
 { \
    read_func(addr, data); \
+   DUMMY_WRITE(write_func, addr, data); \
    data++; \
    write_func(addr, data); \
    SET_NZ_FLAGS(data); \
@@ -679,6 +754,7 @@ do { \
 #define ISB(cycles, read_func, write_func, addr) \
 { \
    read_func(addr, data); \
+   DUMMY_WRITE(write_func, addr, data); \
    data++; \
    write_func(addr, data); \
    SBC(cycles, EMPTY_READ); \
@@ -702,7 +778,7 @@ do { \
 
 #define JMP_INDIRECT() \
 { \
-   temp = bank_readword(PC); \
+   temp = OPERAND_WORD(); \
    /* bug in crossing page boundaries */ \
    if (0xFF == (temp & 0xFF)) \
       PC = (bank_readbyte(temp & 0xFF00) << 8) | bank_readbyte(temp); \
@@ -713,16 +789,17 @@ do { \
 
 #define JMP_ABSOLUTE() \
 { \
-   JUMP(PC); \
+   PC = OPERAND_WORD(); \
    ADD_CYCLES(3); \
 }
 
 #define JSR() \
 { \
+   temp = OPERAND_WORD(); \
    PC++; \
    PUSH(PC >> 8); \
    PUSH(PC & 0xFF); \
-   JUMP(PC - 1); \
+   PC = temp; \
    ADD_CYCLES(6); \
 }
 
@@ -768,6 +845,7 @@ do { \
 #define LSR(cycles, read_func, write_func, addr) \
 { \
    read_func(addr, data); \
+   DUMMY_WRITE(write_func, addr, data); \
    c_flag = data & 1; \
    data >>= 1; \
    write_func(addr, data); \
@@ -830,12 +908,14 @@ do { \
    btemp = PULL(); \
    SCATTER_FLAGS(btemp); \
    ADD_CYCLES(4); \
+   IRQ_UNMASKED(); \
 }
 
 /* undocumented */
 #define RLA(cycles, read_func, write_func, addr) \
 { \
    read_func(addr, data); \
+   DUMMY_WRITE(write_func, addr, data); \
    btemp = c_flag; \
    c_flag = data >> 7; \
    data = (data << 1) | btemp; \
@@ -849,6 +929,7 @@ do { \
 #define ROL(cycles, read_func, write_func, addr) \
 { \
    read_func(addr, data); \
+   DUMMY_WRITE(write_func, addr, data); \
    btemp = c_flag; \
    c_flag = data >> 7; \
    data = (data << 1) | btemp; \
@@ -869,6 +950,7 @@ do { \
 #define ROR(cycles, read_func, write_func, addr) \
 { \
    read_func(addr, data); \
+   DUMMY_WRITE(write_func, addr, data); \
    btemp = c_flag << 7; \
    c_flag = data & 1; \
    data = (data >> 1) | btemp; \
@@ -890,6 +972,7 @@ do { \
 #define RRA(cycles, read_func, write_func, addr) \
 { \
    read_func(addr, data); \
+   DUMMY_WRITE(write_func, addr, data); \
    btemp = c_flag << 7; \
    c_flag = data & 1; \
    data = (data >> 1) | btemp; \
@@ -904,13 +987,7 @@ do { \
    PC = PULL(); \
    PC |= PULL() << 8; \
    ADD_CYCLES(6); \
-   if (0 == i_flag && cpu.int_pending && remaining_cycles > 0) \
-   { \
-      cpu.int_pending = 0; \
-      cpu.irq_was_requested = 0; \
-      IRQ_PROC(); \
-      ADD_CYCLES(INT_CYCLES); \
-   } \
+   IRQ_UNMASKED(); \
 }
 
 #define RTS() \
@@ -1050,6 +1127,7 @@ do { \
 #define SLO(cycles, read_func, write_func, addr) \
 { \
    read_func(addr, data); \
+   DUMMY_WRITE(write_func, addr, data); \
    c_flag = data >> 7; \
    data <<= 1; \
    write_func(addr, data); \
@@ -1062,6 +1140,7 @@ do { \
 #define SRE(cycles, read_func, write_func, addr) \
 { \
    read_func(addr, data); \
+   DUMMY_WRITE(write_func, addr, data); \
    c_flag = data & 1; \
    data >>= 1; \
    write_func(addr, data); \
@@ -1140,8 +1219,43 @@ do { \
 }
 
 /* memory region pointers */
-static uint8 *ram = NULL, *stack = NULL;
-static uint8 null_page[NES6502_BANKSIZE];
+static NES_LOCAL uint8 *ram = NULL, *stack = NULL;
+static NES_LOCAL uint8 null_page[NES6502_BANKSIZE];
+
+#if NES6502_DCACHE
+
+/* decoded instruction cache */
+typedef struct
+{
+   const uint8 *code;   /* host address of the opcode byte, NULL if empty */
+   uint16 operand;
+   uint8 opcode;
+} dcache_t;
+
+static NES_LOCAL dcache_t dcache[NES6502_DCACHE_SIZE];
+
+/* instruction lengths, including undocumented opcodes */
+static const uint8 op_length[256] =
+{
+   1, 2, 1, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3, /* 00 */
+   2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3, /* 10 */
+   3, 2, 1, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3, /* 20 */
+   2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3, /* 30 */
+   1, 2, 1, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3, /* 40 */
+   2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3, /* 50 */
+   1, 2, 1, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3, /* 60 */
+   2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3, /* 70 */
+   2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3, /* 80 */
+   2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3, /* 90 */
+   2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3, /* A0 */
+   2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3, /* B0 */
+   2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3, /* C0 */
+   2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3, /* D0 */
+   2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 2, 3, 3, 3, 3, /* E0 */
+   2, 2, 1, 2, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3  /* F0 */
+};
+
+#endif /* NES6502_DCACHE */
 
 
 /*
@@ -1205,9 +1319,88 @@ INLINE void bank_writebyte(register uint32 address, register uint8 value)
    cpu.mem_page[address >> NES6502_BANKSHIFT][address & NES6502_BANKMASK] = value;
 }
 
+#if NES6502_DCACHE
+
+/* read the operand bytes following the opcode at address */
+INLINE uint32 decode_operand(uint32 address, uint8 opcode)
+{
+   uint32 operand = 0;
+
+   switch (op_length[opcode])
+   {
+   case 3:
+      operand = bank_readbyte((address + 2) & 0xFFFF) << 8;
+      /* fall through */
+   case 2:
+      operand |= bank_readbyte((address + 1) & 0xFFFF);
+      break;
+   }
+
+   return operand;
+}
+
+/* fetch the instruction at address, from the cache where possible */
+INLINE uint8 dcache_fetch(uint32 address, uint32 *operand)
+{
+   const uint8 *code;
+   dcache_t *dc;
+   uint8 opcode;
+
+   /* RAM/WRAM code may be rewritten at any time, and an instruction
+   ** straddling two banks depends on both mappings
+   */
+   if (address < 0x8000 || (address & NES6502_BANKMASK) > NES6502_BANKMASK - 2)
+   {
+      opcode = bank_readbyte(address);
+      *operand = decode_operand(address, opcode);
+      return opcode;
+   }
+
+   code = cpu.mem_page[address >> NES6502_BANKSHIFT] + (address & NES6502_BANKMASK);
+   dc = &dcache[(uintptr_t) code & (NES6502_DCACHE_SIZE - 1)];
+   if (dc->code != code)
+   {
+      dc->code = code;
+      dc->opcode = *code;
+      dc->operand = (uint16) decode_operand(address, dc->opcode);
+   }
+
+   *operand = dc->operand;
+   return dc->opcode;
+}
+
+/* drop any entry whose opcode or operand covers the written byte */
+static void dcache_invalidate(uint32 address)
+{
+   const uint8 *code;
+   dcache_t *dc;
+   int i;
+
+   code = cpu.mem_page[address >> NES6502_BANKSHIFT] + (address & NES6502_BANKMASK);
+   for (i = 0; i < 3; i++, code--)
+   {
+      dc = &dcache[(uintptr_t) code & (NES6502_DCACHE_SIZE - 1)];
+      if (dc->code == code)
+         dc->code = NULL;
+   }
+}
+
+#define  OPERAND_BYTE()   ((uint8) operand)
+#define  OPERAND_WORD()   (operand)
+#define  FETCH_OPCODE()   dcache_fetch(PC++, &operand)
+
+#else /* !NES6502_DCACHE */
+
+#define  OPERAND_BYTE()   bank_readbyte(PC)
+#define  OPERAND_WORD()   bank_readword(PC)
+#define  FETCH_OPCODE()   bank_readbyte(PC++)
+
+#endif /* !NES6502_DCACHE */
+
 /* read a byte of 6502 memory */
 static uint8 mem_readbyte(uint32 address)
 {
+   nes6502_memmap *mm;
    nes6502_memread *mr;
 
    /* TODO: following 2 cases are N2A03-specific */
@@ -1221,8 +1414,16 @@ static uint8 mem_readbyte(uint32 address)
       /* always paged memory */
       return bank_readbyte(address);
    }
-   /* check memory range handlers */
-   else
+
+   /* page owned by a single handler: one indexed load */
+   mm = &cpu.mem_map[address >> NES6502_PAGESHIFT];
+   if (mm->sync && cpu.sync_func)
+      cpu.sync_func();
+   if (mm->read_func)
+      return mm->read_func(address);
+
+   /* page shared between handlers: check memory range handlers */
+   if (mm->read_scan)
    {
       for (mr = cpu.read_handler; mr->min_range != 0xFFFFFFFF; mr++)
       {
@@ -1238,6 +1439,7 @@ static uint8 mem_readbyte(uint32 address)
 /* write a byte of data to 6502 memory */
 static void mem_writebyte(uint32 address, uint8 value)
 {
+   nes6502_memmap *mm;
    nes6502_memwrite *mw;
 
    /* RAM */
@@ -1246,8 +1448,19 @@ static void mem_writebyte(uint32 address, uint8 value)
       ram[address] = value;
       return;
    }
-   /* check memory range handlers */
-   else
+
+   /* page owned by a single handler: one indexed load */
+   mm = &cpu.mem_map[address >> NES6502_PAGESHIFT];
+   if (mm->sync && cpu.sync_func)
+      cpu.sync_func();
+   if (mm->write_func)
+   {
+      mm->write_func(address, value);
+      return;
+   }
+
+   /* page shared between handlers: check memory range handlers */
+   if (mm->write_scan)
    {
       for (mw = cpu.write_handler; mw->min_range != 0xFFFFFFFF; mw++)
       {
@@ -1261,6 +1474,10 @@ static void mem_writebyte(uint32 address, uint8 value)
 
    /* write to paged memory */
    bank_writebyte(address, value);
+#if NES6502_DCACHE
+   if (address >= 0x8000)
+      dcache_invalidate(address);
+#endif /* NES6502_DCACHE */
 }
 
 /* set the current context */
@@ -1300,12 +1517,52 @@ void nes6502_getcontext(nes6502_context *context)
    }
 }
 
+/* point one bank of the live context at new memory (a bankswitch); bank
+** 0 is the internal RAM and stays put
+*/
+void nes6502_setpage(int page, uint8 *ptr)
+{
+   ASSERT(page > 0 && page < NES6502_NUMBANKS);
+
+   cpu.mem_page[page] = ptr ? ptr : null_page;
+}
+
 /* DMA a byte of data from ROM */
 uint8 nes6502_getbyte(uint32 address)
 {
    return bank_readbyte(address);
 }
 
+/* host pointer to the paged memory at address, NULL if nothing is mapped */
+uint8 *nes6502_getptr(uint32 address)
+{
+   uint8 *page = cpu.mem_page[address >> NES6502_BANKSHIFT];
+
+   return page ? page + (address & NES6502_BANKMASK) : NULL;
+}
+
+/* get the address of the next instruction */
+uint32 nes6502_getpc(void)
+{
+   return cpu.pc_reg;
+}
+
+/* Step over an instruction the caller has proven leaves every register
+** and flag unchanged (an idle loop), moving PC on to next_pc.  Returns
+** the cycles consumed, or zero if a pending interrupt or DMA burn means
+** the real core has to run.
+*/
+int nes6502_idle(uint32 next_pc, int cycles)
+{
+   if (cpu.jammed || cpu.burn_cycles || cpu.int_pending || ext_irq_line
+       || nmi_deferred || irq_deferred)
+      return 0;
+
+   cpu.pc_reg = next_pc;
+   cpu.total_cycles += cycles;
+   return cycles;
+}
+
 /* get number of elapsed cycles */
 uint32 nes6502_getcycles(bool reset_flag)
 {
@@ -1339,1076 +1596,241 @@ uint32 nes6502_getcycles(bool reset_flag)
 
 #define  MIN(a,b)    (((a) < (b)) ? (a) : (b))
 
-#ifdef NES6502_JUMPTABLE
-
-#define  OPCODE_BEGIN(xx)  op##xx:
-#ifdef NES6502_DISASM
+#ifdef NES6502_OPSTATS
 
-#define  OPCODE_END \
-   if (remaining_cycles <= 0) \
-      goto end_execute; \
-   log_printf(nes6502_disasm(PC, COMBINE_FLAGS(), A, X, Y, S)); \
-   goto *opcode_table[bank_readbyte(PC++)];
-
-#else /* !NES6520_DISASM */
+/* times each opcode has been dispatched since the last dump */
+static NES_LOCAL uint32 opstats[256];
 
-#define  OPCODE_END \
-   if (remaining_cycles <= 0) \
-      goto end_execute; \
-   goto *opcode_table[bank_readbyte(PC++)];
-
-#endif /* !NES6502_DISASM */
-
-#else /* !NES6502_JUMPTABLE */
-#define  OPCODE_BEGIN(xx)  case 0x##xx:
-#define  OPCODE_END        break;
-#endif /* !NES6502_JUMPTABLE */
-
-
-/* Execute instructions until count expires
-**
-** Returns the number of cycles *actually* executed, which will be
-** anywhere from zero to timeslice_cycles + 6
-*/
-int nes6502_execute(int timeslice_cycles)
+INLINE uint8 opstats_count(uint8 opcode)
 {
-   int old_cycles = cpu.total_cycles;
-
-   uint32 temp, addr; /* for macros */
-   uint8 btemp, baddr; /* for macros */
-   uint8 data;
+   opstats[opcode]++;
+   return opcode;
+}
 
-   /* flags */
-   uint8 n_flag, v_flag, b_flag;
-   uint8 d_flag, i_flag, z_flag, c_flag;
+#define  COUNT_OPCODE(op)  opstats_count(op)
 
-   /* local copies of regs */
-   uint32 PC;
-   uint8 A, X, Y, S;
+/* Log the opcode histogram, most frequent first, and start over */
+void nes6502_dumpopstats(const char *title)
+{
+   uint8 order[256];
+   uint32 total = 0;
+   int i, j;
 
-#ifdef NES6502_JUMPTABLE
-   
-   static const void *opcode_table[256] =
+   for (i = 0; i < 256; i++)
    {
-      &&op00, &&op01, &&op02, &&op03, &&op04, &&op05, &&op06, &&op07,
-      &&op08, &&op09, &&op0A, &&op0B, &&op0C, &&op0D, &&op0E, &&op0F,
-      &&op10, &&op11, &&op12, &&op13, &&op14, &&op15, &&op16, &&op17,
-      &&op18, &&op19, &&op1A, &&op1B, &&op1C, &&op1D, &&op1E, &&op1F,
-      &&op20, &&op21, &&op22, &&op23, &&op24, &&op25, &&op26, &&op27,
-      &&op28, &&op29, &&op2A, &&op2B, &&op2C, &&op2D, &&op2E, &&op2F,
-      &&op30, &&op31, &&op32, &&op33, &&op34, &&op35, &&op36, &&op37,
-      &&op38, &&op39, &&op3A, &&op3B, &&op3C, &&op3D, &&op3E, &&op3F,
-      &&op40, &&op41, &&op42, &&op43, &&op44, &&op45, &&op46, &&op47,
-      &&op48, &&op49, &&op4A, &&op4B, &&op4C, &&op4D, &&op4E, &&op4F,
-      &&op50, &&op51, &&op52, &&op53, &&op54, &&op55, &&op56, &&op57,
-      &&op58, &&op59, &&op5A, &&op5B, &&op5C, &&op5D, &&op5E, &&op5F,
-      &&op60, &&op61, &&op62, &&op63, &&op64, &&op65, &&op66, &&op67,
-      &&op68, &&op69, &&op6A, &&op6B, &&op6C, &&op6D, &&op6E, &&op6F,
-      &&op70, &&op71, &&op72, &&op73, &&op74, &&op75, &&op76, &&op77,
-      &&op78, &&op79, &&op7A, &&op7B, &&op7C, &&op7D, &&op7E, &&op7F,
-      &&op80, &&op81, &&op82, &&op83, &&op84, &&op85, &&op86, &&op87,
-      &&op88, &&op89, &&op8A, &&op8B, &&op8C, &&op8D, &&op8E, &&op8F,
-      &&op90, &&op91, &&op92, &&op93, &&op94, &&op95, &&op96, &&op97,
-      &&op98, &&op99, &&op9A, &&op9B, &&op9C, &&op9D, &&op9E, &&op9F,
-      &&opA0, &&opA1, &&opA2, &&opA3, &&opA4, &&opA5, &&opA6, &&opA7,
-      &&opA8, &&opA9, &&opAA, &&opAB, &&opAC, &&opAD, &&opAE, &&opAF,
-      &&opB0, &&opB1, &&opB2, &&opB3, &&opB4, &&opB5, &&opB6, &&opB7,
-      &&opB8, &&opB9, &&opBA, &&opBB, &&opBC, &&opBD, &&opBE, &&opBF,
-      &&opC0, &&opC1, &&opC2, &&opC3, &&opC4, &&opC5, &&opC6, &&opC7,
-      &&opC8, &&opC9, &&opCA, &&opCB, &&opCC, &&opCD, &&opCE, &&opCF,
-      &&opD0, &&opD1, &&opD2, &&opD3, &&opD4, &&opD5, &&opD6, &&opD7,
-      &&opD8, &&opD9, &&opDA, &&opDB, &&opDC, &&opDD, &&opDE, &&opDF,
-      &&opE0, &&opE1, &&opE2, &&opE3, &&opE4, &&opE5, &&opE6, &&opE7,
-      &&opE8, &&opE9, &&opEA, &&opEB, &&opEC, &&opED, &&opEE, &&opEF,
-      &&opF0, &&opF1, &&opF2, &&opF3, &&opF4, &&opF5, &&opF6, &&opF7,
-      &&opF8, &&opF9, &&opFA, &&opFB, &&opFC, &&opFD, &&opFE, &&opFF
-   };
-
-#endif /* NES6502_JUMPTABLE */
-
-   remaining_cycles = timeslice_cycles;
-
-   GET_GLOBAL_REGS();
-   if (ext_irq_line && remaining_cycles > 0){
-      nes6502_irq();               /* level-triggered behaviour */
+      /* insertion sort, descending by count */
+      for (j = i; j > 0 && opstats[order[j - 1]] < opstats[i]; j--)
+         order[j] = order[j - 1];
+      order[j] = (uint8) i;
+      total += opstats[i];
    }
 
-   /* check for DMA cycle burning */
-   if (cpu.burn_cycles && remaining_cycles > 0)
+   log_printf("opcode histogram: %s, %u dispatches\n", title, total);
+   for (i = 0; i < 256 && total; i++)
    {
-      int burn_for;
-      
-      burn_for = MIN(remaining_cycles, cpu.burn_cycles);
-      ADD_CYCLES(burn_for);
-      cpu.burn_cycles -= burn_for;
-   }
+      uint32 count = opstats[order[i]];
+      uint32 permyriad = (uint32) (((uint64_t) count * 10000) / total);
 
-   if (0 == i_flag && cpu.int_pending && remaining_cycles > 0)
-   {
-      cpu.int_pending = 0;
-      cpu.irq_was_requested = 0;
-      IRQ_PROC();
-      ADD_CYCLES(INT_CYCLES);
+      if (0 == count)
+         break;
+      log_printf("  %02X %10u %3u.%02u%%\n", order[i], count,
+                 permyriad / 100, permyriad % 100);
    }
 
-#ifdef NES6502_JUMPTABLE
-   /* fetch first instruction */
-   OPCODE_END
-
-#else /* !NES6502_JUMPTABLE */
-
-   /* Continue until we run out of cycles */
-   while (remaining_cycles > 0)
-   {
-#ifdef NES6502_DISASM
-      log_printf(nes6502_disasm(PC, COMBINE_FLAGS(), A, X, Y, S));
-#endif /* NES6502_DISASM */
-
-      /* Fetch and execute instruction */
-      switch (bank_readbyte(PC++))
-      {
-#endif /* !NES6502_JUMPTABLE */
-
-      OPCODE_BEGIN(00)  /* BRK */
-         BRK();
-         OPCODE_END
-
-      OPCODE_BEGIN(01)  /* ORA ($nn,X) */
-         ORA(6, INDIR_X_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(02)  /* JAM */
-      OPCODE_BEGIN(12)  /* JAM */
-      OPCODE_BEGIN(22)  /* JAM */
-      OPCODE_BEGIN(32)  /* JAM */
-      OPCODE_BEGIN(42)  /* JAM */
-      OPCODE_BEGIN(52)  /* JAM */
-      OPCODE_BEGIN(62)  /* JAM */
-      OPCODE_BEGIN(72)  /* JAM */
-      OPCODE_BEGIN(92)  /* JAM */
-      OPCODE_BEGIN(B2)  /* JAM */
-      OPCODE_BEGIN(D2)  /* JAM */
-      OPCODE_BEGIN(F2)  /* JAM */
-         JAM();
-         /* kill the CPU */
-         remaining_cycles = 0;
-         OPCODE_END
-
-      OPCODE_BEGIN(03)  /* SLO ($nn,X) */
-         SLO(8, INDIR_X, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(04)  /* NOP $nn */
-      OPCODE_BEGIN(44)  /* NOP $nn */
-      OPCODE_BEGIN(64)  /* NOP $nn */
-         DOP(3);
-         OPCODE_END
-
-      OPCODE_BEGIN(05)  /* ORA $nn */
-         ORA(3, ZERO_PAGE_BYTE); 
-         OPCODE_END
-
-      OPCODE_BEGIN(06)  /* ASL $nn */
-         ASL(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(07)  /* SLO $nn */
-         SLO(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(08)  /* PHP */
-         PHP(); 
-         OPCODE_END
-
-      OPCODE_BEGIN(09)  /* ORA #$nn */
-         ORA(2, IMMEDIATE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(0A)  /* ASL A */
-         ASL_A();
-         OPCODE_END
-
-      OPCODE_BEGIN(0B)  /* ANC #$nn */
-         ANC(2, IMMEDIATE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(0C)  /* NOP $nnnn */
-         TOP(); 
-         OPCODE_END
-
-      OPCODE_BEGIN(0D)  /* ORA $nnnn */
-         ORA(4, ABSOLUTE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(0E)  /* ASL $nnnn */
-         ASL(6, ABSOLUTE, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(0F)  /* SLO $nnnn */
-         SLO(6, ABSOLUTE, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(10)  /* BPL $nnnn */
-         BPL();
-         OPCODE_END
-
-      OPCODE_BEGIN(11)  /* ORA ($nn),Y */
-         ORA(5, INDIR_Y_BYTE_READ);
-         OPCODE_END
-      
-      OPCODE_BEGIN(13)  /* SLO ($nn),Y */
-         SLO(8, INDIR_Y, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(14)  /* NOP $nn,X */
-      OPCODE_BEGIN(34)  /* NOP */
-      OPCODE_BEGIN(54)  /* NOP $nn,X */
-      OPCODE_BEGIN(74)  /* NOP $nn,X */
-      OPCODE_BEGIN(D4)  /* NOP $nn,X */
-      OPCODE_BEGIN(F4)  /* NOP ($nn,X) */
-         DOP(4);
-         OPCODE_END
-
-      OPCODE_BEGIN(15)  /* ORA $nn,X */
-         ORA(4, ZP_IND_X_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(16)  /* ASL $nn,X */
-         ASL(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(17)  /* SLO $nn,X */
-         SLO(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(18)  /* CLC */
-         CLC();
-         OPCODE_END
-
-      OPCODE_BEGIN(19)  /* ORA $nnnn,Y */
-         ORA(4, ABS_IND_Y_BYTE_READ);
-         OPCODE_END
-      
-      OPCODE_BEGIN(1A)  /* NOP */
-      OPCODE_BEGIN(3A)  /* NOP */
-      OPCODE_BEGIN(5A)  /* NOP */
-      OPCODE_BEGIN(7A)  /* NOP */
-      OPCODE_BEGIN(DA)  /* NOP */
-      OPCODE_BEGIN(FA)  /* NOP */
-         NOP();
-         OPCODE_END
-
-      OPCODE_BEGIN(1B)  /* SLO $nnnn,Y */
-         SLO(7, ABS_IND_Y, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(1C)  /* NOP $nnnn,X */
-      OPCODE_BEGIN(3C)  /* NOP $nnnn,X */
-      OPCODE_BEGIN(5C)  /* NOP $nnnn,X */
-      OPCODE_BEGIN(7C)  /* NOP $nnnn,X */
-      OPCODE_BEGIN(DC)  /* NOP $nnnn,X */
-      OPCODE_BEGIN(FC)  /* NOP $nnnn,X */
-         TOP();
-         OPCODE_END
-
-      OPCODE_BEGIN(1D)  /* ORA $nnnn,X */
-         ORA(4, ABS_IND_X_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(1E)  /* ASL $nnnn,X */
-         ASL(7, ABS_IND_X, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(1F)  /* SLO $nnnn,X */
-         SLO(7, ABS_IND_X, mem_writebyte, addr);
-         OPCODE_END
-      
-      OPCODE_BEGIN(20)  /* JSR $nnnn */
-         JSR();
-         OPCODE_END
-
-      OPCODE_BEGIN(21)  /* AND ($nn,X) */
-         AND(6, INDIR_X_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(23)  /* RLA ($nn,X) */
-         RLA(8, INDIR_X, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(24)  /* BIT $nn */
-         BIT(3, ZERO_PAGE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(25)  /* AND $nn */
-         AND(3, ZERO_PAGE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(26)  /* ROL $nn */
-         ROL(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(27)  /* RLA $nn */
-         RLA(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(28)  /* PLP */
-         PLP();
-         OPCODE_END
-
-      OPCODE_BEGIN(29)  /* AND #$nn */
-         AND(2, IMMEDIATE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(2A)  /* ROL A */
-         ROL_A();
-         OPCODE_END
-
-      OPCODE_BEGIN(2B)  /* ANC #$nn */
-         ANC(2, IMMEDIATE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(2C)  /* BIT $nnnn */
-         BIT(4, ABSOLUTE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(2D)  /* AND $nnnn */
-         AND(4, ABSOLUTE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(2E)  /* ROL $nnnn */
-         ROL(6, ABSOLUTE, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(2F)  /* RLA $nnnn */
-         RLA(6, ABSOLUTE, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(30)  /* BMI $nnnn */
-         BMI();
-         OPCODE_END
-
-      OPCODE_BEGIN(31)  /* AND ($nn),Y */
-         AND(5, INDIR_Y_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(33)  /* RLA ($nn),Y */
-         RLA(8, INDIR_Y, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(35)  /* AND $nn,X */
-         AND(4, ZP_IND_X_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(36)  /* ROL $nn,X */
-         ROL(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(37)  /* RLA $nn,X */
-         RLA(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(38)  /* SEC */
-         SEC();
-         OPCODE_END
-
-      OPCODE_BEGIN(39)  /* AND $nnnn,Y */
-         AND(4, ABS_IND_Y_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(3B)  /* RLA $nnnn,Y */
-         RLA(7, ABS_IND_Y, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(3D)  /* AND $nnnn,X */
-         AND(4, ABS_IND_X_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(3E)  /* ROL $nnnn,X */
-         ROL(7, ABS_IND_X, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(3F)  /* RLA $nnnn,X */
-         RLA(7, ABS_IND_X, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(40)  /* RTI */
-         RTI();
-         OPCODE_END
-
-      OPCODE_BEGIN(41)  /* EOR ($nn,X) */
-         EOR(6, INDIR_X_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(43)  /* SRE ($nn,X) */
-         SRE(8, INDIR_X, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(45)  /* EOR $nn */
-         EOR(3, ZERO_PAGE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(46)  /* LSR $nn */
-         LSR(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(47)  /* SRE $nn */
-         SRE(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(48)  /* PHA */
-         PHA();
-         OPCODE_END
-
-      OPCODE_BEGIN(49)  /* EOR #$nn */
-         EOR(2, IMMEDIATE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(4A)  /* LSR A */
-         LSR_A();
-         OPCODE_END
-
-      OPCODE_BEGIN(4B)  /* ASR #$nn */
-         ASR(2, IMMEDIATE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(4C)  /* JMP $nnnn */
-         JMP_ABSOLUTE();
-         OPCODE_END
-
-      OPCODE_BEGIN(4D)  /* EOR $nnnn */
-         EOR(4, ABSOLUTE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(4E)  /* LSR $nnnn */
-         LSR(6, ABSOLUTE, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(4F)  /* SRE $nnnn */
-         SRE(6, ABSOLUTE, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(50)  /* BVC $nnnn */
-         BVC();
-         OPCODE_END
-
-      OPCODE_BEGIN(51)  /* EOR ($nn),Y */
-         EOR(5, INDIR_Y_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(53)  /* SRE ($nn),Y */
-         SRE(8, INDIR_Y, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(55)  /* EOR $nn,X */
-         EOR(4, ZP_IND_X_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(56)  /* LSR $nn,X */
-         LSR(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(57)  /* SRE $nn,X */
-         SRE(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(58)  /* CLI */
-         CLI();
-         OPCODE_END
-
-      OPCODE_BEGIN(59)  /* EOR $nnnn,Y */
-         EOR(4, ABS_IND_Y_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(5B)  /* SRE $nnnn,Y */
-         SRE(7, ABS_IND_Y, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(5D)  /* EOR $nnnn,X */
-         EOR(4, ABS_IND_X_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(5E)  /* LSR $nnnn,X */
-         LSR(7, ABS_IND_X, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(5F)  /* SRE $nnnn,X */
-         SRE(7, ABS_IND_X, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(60)  /* RTS */
-         RTS();
-         OPCODE_END
-
-      OPCODE_BEGIN(61)  /* ADC ($nn,X) */
-         ADC(6, INDIR_X_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(63)  /* RRA ($nn,X) */
-         RRA(8, INDIR_X, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(65)  /* ADC $nn */
-         ADC(3, ZERO_PAGE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(66)  /* ROR $nn */
-         ROR(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(67)  /* RRA $nn */
-         RRA(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(68)  /* PLA */
-         PLA();
-         OPCODE_END
+   memset(opstats, 0, sizeof(opstats));
+}
 
-      OPCODE_BEGIN(69)  /* ADC #$nn */
-         ADC(2, IMMEDIATE_BYTE);
-         OPCODE_END
+#else /* !NES6502_OPSTATS */
 
-      OPCODE_BEGIN(6A)  /* ROR A */
-         ROR_A();
-         OPCODE_END
+#define  COUNT_OPCODE(op)  (op)
 
-      OPCODE_BEGIN(6B)  /* ARR #$nn */
-         ARR(2, IMMEDIATE_BYTE);
-         OPCODE_END
+#endif /* !NES6502_OPSTATS */
 
-      OPCODE_BEGIN(6C)  /* JMP ($nnnn) */
-         JMP_INDIRECT();
-         OPCODE_END
+#ifdef NES6502_PCPROF
 
-      OPCODE_BEGIN(6D)  /* ADC $nnnn */
-         ADC(4, ABSOLUTE_BYTE);
-         OPCODE_END
+#ifndef NES6502_PCPROF_SIZE
+#define  NES6502_PCPROF_SIZE  256 /* buckets, must be a power of two */
+#endif /* !NES6502_PCPROF_SIZE */
 
-      OPCODE_BEGIN(6E)  /* ROR $nnnn */
-         ROR(6, ABSOLUTE, mem_writebyte, addr);
-         OPCODE_END
+/* Cycles spent per 256-byte page of code.  Buckets are keyed by the
+** host address of the page, so every bank of a bankswitched ROM is
+** counted on its own.  Each instruction boundary is a sample: the
+** cycles since the previous one (interrupts and DMA included) go to
+** the page that was running.
+*/
+typedef struct
+{
+   const uint8 *page;   /* host address, NULL if unused */
+   uint32 address;      /* 6502 address it was first seen at */
+   uint32 cycles;
+} pcprof_t;
 
-      OPCODE_BEGIN(6F)  /* RRA $nnnn */
-         RRA(6, ABSOLUTE, mem_writebyte, addr);
-         OPCODE_END
+static NES_LOCAL pcprof_t pcprof[NES6502_PCPROF_SIZE];
+static NES_LOCAL pcprof_t pcprof_other;      /* pages that didn't fit */
+static NES_LOCAL pcprof_t *pcprof_last = NULL;
+static NES_LOCAL int32 pcprof_cycles;
 
-      OPCODE_BEGIN(70)  /* BVS $nnnn */
-         BVS();
-         OPCODE_END
-
-      OPCODE_BEGIN(71)  /* ADC ($nn),Y */
-         ADC(5, INDIR_Y_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(73)  /* RRA ($nn),Y */
-         RRA(8, INDIR_Y, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(75)  /* ADC $nn,X */
-         ADC(4, ZP_IND_X_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(76)  /* ROR $nn,X */
-         ROR(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(77)  /* RRA $nn,X */
-         RRA(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(78)  /* SEI */
-         SEI();
-         OPCODE_END
-
-      OPCODE_BEGIN(79)  /* ADC $nnnn,Y */
-         ADC(4, ABS_IND_Y_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(7B)  /* RRA $nnnn,Y */
-         RRA(7, ABS_IND_Y, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(7D)  /* ADC $nnnn,X */
-         ADC(4, ABS_IND_X_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(7E)  /* ROR $nnnn,X */
-         ROR(7, ABS_IND_X, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(7F)  /* RRA $nnnn,X */
-         RRA(7, ABS_IND_X, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(80)  /* NOP #$nn */
-      OPCODE_BEGIN(82)  /* NOP #$nn */
-      OPCODE_BEGIN(89)  /* NOP #$nn */
-      OPCODE_BEGIN(C2)  /* NOP #$nn */
-      OPCODE_BEGIN(E2)  /* NOP #$nn */
-         DOP(2);
-         OPCODE_END
-
-      OPCODE_BEGIN(81)  /* STA ($nn,X) */
-         STA(6, INDIR_X_ADDR, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(83)  /* SAX ($nn,X) */
-         SAX(6, INDIR_X_ADDR, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(84)  /* STY $nn */
-         STY(3, ZERO_PAGE_ADDR, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(85)  /* STA $nn */
-         STA(3, ZERO_PAGE_ADDR, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(86)  /* STX $nn */
-         STX(3, ZERO_PAGE_ADDR, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(87)  /* SAX $nn */
-         SAX(3, ZERO_PAGE_ADDR, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(88)  /* DEY */
-         DEY();
-         OPCODE_END
-
-      OPCODE_BEGIN(8A)  /* TXA */
-         TXA();
-         OPCODE_END
-
-      OPCODE_BEGIN(8B)  /* ANE #$nn */
-         ANE(2, IMMEDIATE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(8C)  /* STY $nnnn */
-         STY(4, ABSOLUTE_ADDR, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(8D)  /* STA $nnnn */
-         STA(4, ABSOLUTE_ADDR, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(8E)  /* STX $nnnn */
-         STX(4, ABSOLUTE_ADDR, mem_writebyte, addr);
-         OPCODE_END
-      
-      OPCODE_BEGIN(8F)  /* SAX $nnnn */
-         SAX(4, ABSOLUTE_ADDR, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(90)  /* BCC $nnnn */
-         BCC();
-         OPCODE_END
-
-      OPCODE_BEGIN(91)  /* STA ($nn),Y */
-         STA(6, INDIR_Y_ADDR, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(93)  /* SHA ($nn),Y */
-         SHA(6, INDIR_Y_ADDR, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(94)  /* STY $nn,X */
-         STY(4, ZP_IND_X_ADDR, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(95)  /* STA $nn,X */
-         STA(4, ZP_IND_X_ADDR, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(96)  /* STX $nn,Y */
-         STX(4, ZP_IND_Y_ADDR, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(97)  /* SAX $nn,Y */
-         SAX(4, ZP_IND_Y_ADDR, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(98)  /* TYA */
-         TYA();
-         OPCODE_END
-
-      OPCODE_BEGIN(99)  /* STA $nnnn,Y */
-         STA(5, ABS_IND_Y_ADDR, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(9A)  /* TXS */
-         TXS();
-         OPCODE_END
-
-      OPCODE_BEGIN(9B)  /* SHS $nnnn,Y */
-         SHS(5, ABS_IND_Y_ADDR, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(9C)  /* SHY $nnnn,X */
-         SHY(5, ABS_IND_X_ADDR, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(9D)  /* STA $nnnn,X */
-         STA(5, ABS_IND_X_ADDR, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(9E)  /* SHX $nnnn,Y */
-         SHX(5, ABS_IND_Y_ADDR, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(9F)  /* SHA $nnnn,Y */
-         SHA(5, ABS_IND_Y_ADDR, mem_writebyte, addr);
-         OPCODE_END
-      
-      OPCODE_BEGIN(A0)  /* LDY #$nn */
-         LDY(2, IMMEDIATE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(A1)  /* LDA ($nn,X) */
-         LDA(6, INDIR_X_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(A2)  /* LDX #$nn */
-         LDX(2, IMMEDIATE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(A3)  /* LAX ($nn,X) */
-         LAX(6, INDIR_X_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(A4)  /* LDY $nn */
-         LDY(3, ZERO_PAGE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(A5)  /* LDA $nn */
-         LDA(3, ZERO_PAGE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(A6)  /* LDX $nn */
-         LDX(3, ZERO_PAGE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(A7)  /* LAX $nn */
-         LAX(3, ZERO_PAGE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(A8)  /* TAY */
-         TAY();
-         OPCODE_END
-
-      OPCODE_BEGIN(A9)  /* LDA #$nn */
-         LDA(2, IMMEDIATE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(AA)  /* TAX */
-         TAX();
-         OPCODE_END
-
-      OPCODE_BEGIN(AB)  /* LXA #$nn */
-         LXA(2, IMMEDIATE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(AC)  /* LDY $nnnn */
-         LDY(4, ABSOLUTE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(AD)  /* LDA $nnnn */
-         LDA(4, ABSOLUTE_BYTE);
-         OPCODE_END
-      
-      OPCODE_BEGIN(AE)  /* LDX $nnnn */
-         LDX(4, ABSOLUTE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(AF)  /* LAX $nnnn */
-         LAX(4, ABSOLUTE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(B0)  /* BCS $nnnn */
-         BCS();
-         OPCODE_END
-
-      OPCODE_BEGIN(B1)  /* LDA ($nn),Y */
-         LDA(5, INDIR_Y_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(B3)  /* LAX ($nn),Y */
-         LAX(5, INDIR_Y_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(B4)  /* LDY $nn,X */
-         LDY(4, ZP_IND_X_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(B5)  /* LDA $nn,X */
-         LDA(4, ZP_IND_X_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(B6)  /* LDX $nn,Y */
-         LDX(4, ZP_IND_Y_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(B7)  /* LAX $nn,Y */
-         LAX(4, ZP_IND_Y_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(B8)  /* CLV */
-         CLV();
-         OPCODE_END
-
-      OPCODE_BEGIN(B9)  /* LDA $nnnn,Y */
-         LDA(4, ABS_IND_Y_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(BA)  /* TSX */
-         TSX();
-         OPCODE_END
-
-      OPCODE_BEGIN(BB)  /* LAS $nnnn,Y */
-         LAS(4, ABS_IND_Y_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(BC)  /* LDY $nnnn,X */
-         LDY(4, ABS_IND_X_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(BD)  /* LDA $nnnn,X */
-         LDA(4, ABS_IND_X_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(BE)  /* LDX $nnnn,Y */
-         LDX(4, ABS_IND_Y_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(BF)  /* LAX $nnnn,Y */
-         LAX(4, ABS_IND_Y_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(C0)  /* CPY #$nn */
-         CPY(2, IMMEDIATE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(C1)  /* CMP ($nn,X) */
-         CMP(6, INDIR_X_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(C3)  /* DCP ($nn,X) */
-         DCP(8, INDIR_X, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(C4)  /* CPY $nn */
-         CPY(3, ZERO_PAGE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(C5)  /* CMP $nn */
-         CMP(3, ZERO_PAGE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(C6)  /* DEC $nn */
-         DEC(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(C7)  /* DCP $nn */
-         DCP(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(C8)  /* INY */
-         INY();
-         OPCODE_END
-
-      OPCODE_BEGIN(C9)  /* CMP #$nn */
-         CMP(2, IMMEDIATE_BYTE);
-         OPCODE_END
+INLINE void pcprof_sample(uint32 address)
+{
+   const uint8 *page;
+   pcprof_t *entry;
+   uint32 hash;
+   int probe;
 
-      OPCODE_BEGIN(CA)  /* DEX */
-         DEX();
-         OPCODE_END
+   page = cpu.mem_page[address >> NES6502_BANKSHIFT] + (address & NES6502_BANKMASK & 0xFF00);
 
-      OPCODE_BEGIN(CB)  /* SBX #$nn */
-         SBX(2, IMMEDIATE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(CC)  /* CPY $nnnn */
-         CPY(4, ABSOLUTE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(CD)  /* CMP $nnnn */
-         CMP(4, ABSOLUTE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(CE)  /* DEC $nnnn */
-         DEC(6, ABSOLUTE, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(CF)  /* DCP $nnnn */
-         DCP(6, ABSOLUTE, mem_writebyte, addr);
-         OPCODE_END
-      
-      OPCODE_BEGIN(D0)  /* BNE $nnnn */
-         BNE();
-         OPCODE_END
-
-      OPCODE_BEGIN(D1)  /* CMP ($nn),Y */
-         CMP(5, INDIR_Y_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(D3)  /* DCP ($nn),Y */
-         DCP(8, INDIR_Y, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(D5)  /* CMP $nn,X */
-         CMP(4, ZP_IND_X_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(D6)  /* DEC $nn,X */
-         DEC(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(D7)  /* DCP $nn,X */
-         DCP(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
-         OPCODE_END
-
-      OPCODE_BEGIN(D8)  /* CLD */
-         CLD();
-         OPCODE_END
-
-      OPCODE_BEGIN(D9)  /* CMP $nnnn,Y */
-         CMP(4, ABS_IND_Y_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(DB)  /* DCP $nnnn,Y */
-         DCP(7, ABS_IND_Y, mem_writebyte, addr);
-         OPCODE_END                  
-
-      OPCODE_BEGIN(DD)  /* CMP $nnnn,X */
-         CMP(4, ABS_IND_X_BYTE_READ);
-         OPCODE_END
-
-      OPCODE_BEGIN(DE)  /* DEC $nnnn,X */
-         DEC(7, ABS_IND_X, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(DF)  /* DCP $nnnn,X */
-         DCP(7, ABS_IND_X, mem_writebyte, addr);
-         OPCODE_END
-
-      OPCODE_BEGIN(E0)  /* CPX #$nn */
-         CPX(2, IMMEDIATE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(E1)  /* SBC ($nn,X) */
-         SBC(6, INDIR_X_BYTE);
-         OPCODE_END
+   if (pcprof_last)
+      pcprof_last->cycles += cpu.total_cycles - pcprof_cycles;
+   pcprof_cycles = cpu.total_cycles;
 
-      OPCODE_BEGIN(E3)  /* ISB ($nn,X) */
-         ISB(8, INDIR_X, mem_writebyte, addr);
-         OPCODE_END
+   /* still on the same page: the common case */
+   if (pcprof_last && pcprof_last->page == page)
+      return;
 
-      OPCODE_BEGIN(E4)  /* CPX $nn */
-         CPX(3, ZERO_PAGE_BYTE);
-         OPCODE_END
+   hash = (uint32) ((uintptr_t) page >> 8);
+   for (probe = 0; probe < NES6502_PCPROF_SIZE; probe++)
+   {
+      entry = &pcprof[(hash + probe) & (NES6502_PCPROF_SIZE - 1)];
+      if (NULL == entry->page)
+      {
+         entry->page = page;
+         entry->address = address & 0xFF00;
+      }
+      if (entry->page == page)
+      {
+         pcprof_last = entry;
+         return;
+      }
+   }
 
-      OPCODE_BEGIN(E5)  /* SBC $nn */
-         SBC(3, ZERO_PAGE_BYTE);
-         OPCODE_END
+   pcprof_last = &pcprof_other;
+}
 
-      OPCODE_BEGIN(E6)  /* INC $nn */
-         INC(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
-         OPCODE_END
+#define  PROFILE_PC()  pcprof_sample(PC)
 
-      OPCODE_BEGIN(E7)  /* ISB $nn */
-         ISB(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
-         OPCODE_END
+/* Log the profile as flat text, busiest page first, and start over.
+** Pages inside prg (the cart's PRG ROM) are shown with their offset
+** into it, so that banks can be told apart.
+*/
+void nes6502_dumpprofile(const char *title, const uint8 *prg, uint32 prg_size)
+{
+   uint16 order[NES6502_PCPROF_SIZE];
+   uint32 total = pcprof_other.cycles;
+   int count = 0;
+   int i, j;
 
-      OPCODE_BEGIN(E8)  /* INX */
-         INX();
-         OPCODE_END
+   for (i = 0; i < NES6502_PCPROF_SIZE; i++)
+   {
+      if (NULL == pcprof[i].page)
+         continue;
+
+      /* insertion sort, descending by cycles */
+      for (j = count; j > 0 && pcprof[order[j - 1]].cycles < pcprof[i].cycles; j--)
+         order[j] = order[j - 1];
+      order[j] = (uint16) i;
+      count++;
+      total += pcprof[i].cycles;
+   }
 
-      OPCODE_BEGIN(E9)  /* SBC #$nn */
-      OPCODE_BEGIN(EB)  /* USBC #$nn */
-         SBC(2, IMMEDIATE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(EA)  /* NOP */
-         NOP();
-         OPCODE_END
-
-      OPCODE_BEGIN(EC)  /* CPX $nnnn */
-         CPX(4, ABSOLUTE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(ED)  /* SBC $nnnn */
-         SBC(4, ABSOLUTE_BYTE);
-         OPCODE_END
-
-      OPCODE_BEGIN(EE)  /* INC $nnnn */
-         INC(6, ABSOLUTE, mem_writebyte, addr);
-         OPCODE_END
+   log_printf("pc profile: %s, %u cycles\n", title, total);
+   log_printf("  page   prg        cycles       %%\n");
+   for (i = 0; i < count && total; i++)
+   {
+      pcprof_t *entry = &pcprof[order[i]];
+      uint32 permyriad = (uint32) (((uint64_t) entry->cycles * 10000) / total);
+
+      if (prg && entry->page >= prg && entry->page < prg + prg_size)
+         log_printf("  $%04X  %06X %10u %3u.%02u%%\n", entry->address,
+                    (uint32) (entry->page - prg), entry->cycles,
+                    permyriad / 100, permyriad % 100);
+      else
+         log_printf("  $%04X  ------ %10u %3u.%02u%%\n", entry->address,
+                    entry->cycles, permyriad / 100, permyriad % 100);
+   }
+   if (pcprof_other.cycles)
+      log_printf("  (table full) %10u\n", pcprof_other.cycles);
 
-      OPCODE_BEGIN(EF)  /* ISB $nnnn */
-         ISB(6, ABSOLUTE, mem_writebyte, addr);
-         OPCODE_END
+   memset(pcprof, 0, sizeof(pcprof));
+   memset(&pcprof_other, 0, sizeof(pcprof_other));
+   pcprof_last = NULL;
+}
 
-      OPCODE_BEGIN(F0)  /* BEQ $nnnn */
-         BEQ();
-         OPCODE_END
+#else /* !NES6502_PCPROF */
 
-      OPCODE_BEGIN(F1)  /* SBC ($nn),Y */
-         SBC(5, INDIR_Y_BYTE_READ);
-         OPCODE_END
+#define  PROFILE_PC()  /* empty */
 
-      OPCODE_BEGIN(F3)  /* ISB ($nn),Y */
-         ISB(8, INDIR_Y, mem_writebyte, addr);
-         OPCODE_END
+#endif /* !NES6502_PCPROF */
 
-      OPCODE_BEGIN(F5)  /* SBC $nn,X */
-         SBC(4, ZP_IND_X_BYTE);
-         OPCODE_END
+#ifdef NES6502_JUMPTABLE
 
-      OPCODE_BEGIN(F6)  /* INC $nn,X */
-         INC(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
-         OPCODE_END
+#define  OPCODE_BEGIN(xx)  op##xx:
+#ifdef NES6502_DISASM
 
-      OPCODE_BEGIN(F7)  /* ISB $nn,X */
-         ISB(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
-         OPCODE_END
+#define  OPCODE_END \
+   if (remaining_cycles <= 0) \
+      goto end_execute; \
+   log_printf(nes6502_disasm(PC, COMBINE_FLAGS(), A, X, Y, S)); \
+   PROFILE_PC(); \
+   goto *opcode_table[COUNT_OPCODE(FETCH_OPCODE())];
 
-      OPCODE_BEGIN(F8)  /* SED */
-         SED();
-         OPCODE_END
+#else /* !NES6520_DISASM */
 
-      OPCODE_BEGIN(F9)  /* SBC $nnnn,Y */
-         SBC(4, ABS_IND_Y_BYTE_READ);
-         OPCODE_END
+#define  OPCODE_END \
+   if (remaining_cycles <= 0) \
+      goto end_execute; \
+   PROFILE_PC(); \
+   goto *opcode_table[COUNT_OPCODE(FETCH_OPCODE())];
 
-      OPCODE_BEGIN(FB)  /* ISB $nnnn,Y */
-         ISB(7, ABS_IND_Y, mem_writebyte, addr);
-         OPCODE_END
+#endif /* !NES6502_DISASM */
 
-      OPCODE_BEGIN(FD)  /* SBC $nnnn,X */
-         SBC(4, ABS_IND_X_BYTE_READ);
-         OPCODE_END
+#else /* !NES6502_JUMPTABLE */
+#define  OPCODE_BEGIN(xx)  case 0x##xx:
+#define  OPCODE_END        break;
+#endif /* !NES6502_JUMPTABLE */
 
-      OPCODE_BEGIN(FE)  /* INC $nnnn,X */
-         INC(7, ABS_IND_X, mem_writebyte, addr);
-         OPCODE_END
 
-      OPCODE_BEGIN(FF)  /* ISB $nnnn,X */
-         ISB(7, ABS_IND_X, mem_writebyte, addr);
-         OPCODE_END
+/* Batched core: memory accesses happen at the start of the instruction
+** and its cycles are added in one go at the end of it
+*/
+#define  NES6502_EXECUTE   nes6502_execute_fast
+#include "nes6502_exec.h"
+#undef   NES6502_EXECUTE
 
-#ifdef NES6502_JUMPTABLE
-end_execute:
+#ifdef NES6502_BUSHOOK
+static NES_LOCAL int bus_cycles; /* cycles clocked by the bus ahead of ADD_CYCLES */
+static int nes6502_execute_bus(int timeslice_cycles);
+#endif /* NES6502_BUSHOOK */
 
-#else /* !NES6502_JUMPTABLE */
-      }
+/* Execute instructions until count expires
+**
+** Returns the number of cycles *actually* executed, which will be
+** anywhere from zero to timeslice_cycles + 6
+*/
+int nes6502_execute(int timeslice_cycles)
+{
+   /* interrupts raised by a device mid-slice, now that the
+   ** registers are back in the context
+   */
+   if (nmi_deferred)
+   {
+      nmi_deferred = false;
+      nes6502_nmi();
+   }
+   if (irq_deferred)
+   {
+      irq_deferred = false;
+      nes6502_irq();
    }
-#endif /* !NES6502_JUMPTABLE */
 
-   /* store local copy of regs */
-   STORE_LOCAL_REGS();
+#ifdef NES6502_BUSHOOK
+   if (cpu.bus_hook)
+   {
+      bus_cycles = 0;
+      return nes6502_execute_bus(timeslice_cycles);
+   }
+#endif /* NES6502_BUSHOOK */
 
-   /* Return our actual amount of executed cycles */
-   return (cpu.total_cycles - old_cycles);
+   return nes6502_execute_fast(timeslice_cycles);
 }
 
 /* Issue a CPU Reset */
@@ -2421,6 +1843,11 @@ void nes6502_reset(void)
    cpu.pc_reg = bank_readword(RESET_VECTOR); /* Fetch reset vector */
    cpu.burn_cycles = RESET_CYCLES;
    cpu.jammed = false;
+
+#if NES6502_DCACHE
+   /* a new cart may reuse the host addresses of the old one */
+   memset(dcache, 0, sizeof(dcache));
+#endif /* NES6502_DCACHE */
 }
 
 /* following macro is used for below 2 functions */
@@ -2435,6 +1862,14 @@ void nes6502_nmi(void)
 {
    DECLARE_LOCAL_REGS
 
+   /* a device raised it from inside the core: take it after the slice */
+   if (executing)
+   {
+      nmi_deferred = true;
+      remaining_cycles = 0;
+      return;
+   }
+
    if (false == cpu.jammed)
    {
       GET_GLOBAL_REGS();
@@ -2448,6 +1883,12 @@ void nes6502_irq(void)
 {
     DECLARE_LOCAL_REGS
 
+    if (executing) {
+        irq_deferred = true;
+        remaining_cycles = 0;
+        return;
+    }
+
     if (!cpu.jammed) {
         GET_GLOBAL_REGS();
         if (i_flag == 0) {
@@ -2480,8 +1921,159 @@ void nes6502_release(void)
 void nes6502_clear_pending_irq(void)
 {
     cpu.int_pending = 0;      /* cpu is in this translation unit   */
+    irq_deferred = false;
+}
+
+#ifdef NES6502_BUSHOOK
+
+/*
+** Per-cycle core
+**
+** The opcodes are generated again with every access going through the
+** bus: each read or write is reported to cpu.bus_hook and clocked as
+** it happens, dummy reads and writes included.  ADD_CYCLES then only
+** adds whatever the bus hasn't clocked yet (internal cycles).  This
+** section comes last so that everything above uses the plain memory
+** functions.
+*/
+
+/* one bus cycle, reported once the access has been made */
+INLINE void bus_cycle(uint32 address, uint8 value, int write)
+{
+   cpu.bus_hook(address, value, write);
+   bus_cycles++;
+   cpu_advance_cycles(1);
 }
 
+INLINE uint8 bus_readbyte(uint32 address)
+{
+   uint8 value = mem_readbyte(address);
+
+   bus_cycle(address, value, 0);
+   return value;
+}
+
+INLINE void bus_writebyte(uint32 address, uint8 value)
+{
+   mem_writebyte(address, value);
+   bus_cycle(address, value, 1);
+}
+
+INLINE uint8 bus_bankbyte(uint32 address)
+{
+   uint8 value = bank_readbyte(address);
+
+   bus_cycle(address, value, 0);
+   return value;
+}
+
+INLINE uint32 bus_bankword(uint32 address)
+{
+   uint32 value = bank_readword(address);
+
+   bus_cycle(address, (uint8) value, 0);
+   bus_cycle((address + 1) & 0xFFFF, (uint8) (value >> 8), 0);
+   return value;
+}
+
+INLINE uint8 bus_zpreadbyte(uint8 address)
+{
+   bus_cycle(address, ram[address], 0);
+   return ram[address];
+}
+
+INLINE void bus_zpwritebyte(uint8 address, uint8 value)
+{
+   ram[address] = value;
+   bus_cycle(address, value, 1);
+}
+
+INLINE uint32 bus_zpreadword(uint8 address)
+{
+   uint32 value = zp_readword(address);
+
+   bus_cycle(address, (uint8) value, 0);
+   bus_cycle((uint8) (address + 1), (uint8) (value >> 8), 0);
+   return value;
+}
+
+INLINE void bus_push(uint8 s, uint8 value)
+{
+   stack[s] = value;
+   bus_cycle(STACK_OFFSET + s, value, 1);
+}
+
+INLINE uint8 bus_pull(uint8 s)
+{
+   bus_cycle(STACK_OFFSET + s, stack[s], 0);
+   return stack[s];
+}
+
+#if NES6502_DCACHE
+INLINE uint8 bus_fetch(uint32 address, uint32 *operand)
+{
+   uint8 opcode = dcache_fetch(address, operand);
+
+   bus_cycle(address, opcode, 0);
+   return opcode;
+}
+
+INLINE uint32 bus_operand(uint32 address, uint32 operand, int length)
+{
+   bus_cycle(address, (uint8) operand, 0);
+   if (2 == length)
+      bus_cycle((address + 1) & 0xFFFF, (uint8) (operand >> 8), 0);
+   return operand;
+}
+#endif /* NES6502_DCACHE */
+
+#define  mem_readbyte(address)         bus_readbyte(address)
+#define  mem_writebyte(address, value) bus_writebyte(address, value)
+#define  bank_readbyte(address)        bus_bankbyte(address)
+#define  bank_readword(address)        bus_bankword(address)
+#define  zp_readword(address)          bus_zpreadword(address)
+
+#undef   ZP_READBYTE
+#undef   ZP_WRITEBYTE
+#define  ZP_READBYTE(addr)          bus_zpreadbyte(addr)
+#define  ZP_WRITEBYTE(addr, value)  bus_zpwritebyte(addr, (uint8) (value))
+
+#undef   PUSH
+#undef   PULL
+#define  PUSH(value)                bus_push(S--, (uint8) (value))
+#define  PULL()                     bus_pull(++S)
+
+#if NES6502_DCACHE
+#undef   OPERAND_BYTE
+#undef   OPERAND_WORD
+#undef   FETCH_OPCODE
+#define  OPERAND_BYTE()   ((uint8) bus_operand(PC, operand, 1))
+#define  OPERAND_WORD()   bus_operand(PC, operand, 2)
+#define  FETCH_OPCODE()   bus_fetch(PC++, &operand)
+#endif /* NES6502_DCACHE */
+
+#undef   DUMMY_READ
+#undef   ZP_DUMMY_READ
+#undef   DUMMY_WRITE
+#define  DUMMY_READ(addr)                     (void) mem_readbyte(addr)
+#define  ZP_DUMMY_READ(addr)                  (void) ZP_READBYTE(addr)
+#define  DUMMY_WRITE(write_func, addr, value) write_func(addr, value)
+
+#undef   ADD_CYCLES
+#define  ADD_CYCLES(x) \
+do { \
+   int owed = (x) - bus_cycles; \
+   bus_cycles = (owed < 0) ? -owed : 0; \
+   if (owed > 0) \
+      cpu_advance_cycles(owed); \
+} while(0)
+
+#define  NES6502_EXECUTE   nes6502_execute_bus
+#include "nes6502_exec.h"
+#undef   NES6502_EXECUTE
+
+#endif /* NES6502_BUSHOOK */
+
 /*
 ** $Log: nes6502.c,v $
 ** Revision 1.2  2001/04/27 14:37:11  neil
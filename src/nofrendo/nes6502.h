@@ -36,11 +36,22 @@
 /* Define this to enable decimal mode in ADC / SBC (not needed in NES) */
 /*#define  NES6502_DECIMAL*/
 
+/* Define this to count opcode dispatches, dumped per ROM to the log */
+/*#define  NES6502_OPSTATS*/
+
+/* Define this to profile cycles per page of code, dumped likewise */
+/*#define  NES6502_PCPROF*/
+
 #define  NES6502_NUMBANKS  16
 #define  NES6502_BANKSHIFT 12
 #define  NES6502_BANKSIZE  (0x10000 / NES6502_NUMBANKS)
 #define  NES6502_BANKMASK  (NES6502_BANKSIZE - 1)
 
+/* 256-byte pages used by the compiled memory dispatch table */
+#define  NES6502_NUMPAGES  256
+#define  NES6502_PAGESHIFT 8
+#define  NES6502_PAGESIZE  (0x10000 / NES6502_NUMPAGES)
+
 /* P (flag) register bitmasks */
 #define  N_FLAG         0x80
 #define  V_FLAG         0x40
@@ -78,12 +89,29 @@ typedef struct
    void (*write_func)(uint32 address, uint8 value);
 } nes6502_memwrite;
 
+/* One entry per 256-byte page, compiled from the handler lists.  A NULL
+** function means paged memory; the scan flags mark pages that are split
+** between several handlers and still need the linear handler walk.  The
+** sync flag marks register pages: the rest of the machine is caught up
+** through sync_func before their handlers run.
+*/
+typedef struct
+{
+   uint8 (*read_func)(uint32 address);
+   void (*write_func)(uint32 address, uint8 value);
+   uint8 read_scan, write_scan;
+   uint8 sync;
+} nes6502_memmap;
+
 typedef struct
 {
    uint8 *mem_page[NES6502_NUMBANKS];  /* memory page pointers */
 
    nes6502_memread *read_handler;
    nes6502_memwrite *write_handler;
+   nes6502_memmap *mem_map;            /* NES6502_NUMPAGES entries */
+   void (*sync_func)(void);            /* called before register access */
+   void (*bus_hook)(uint32 address, uint8 value, int write); /* per-cycle core if set */
 
    uint32 pc_reg;
    uint8 a_reg, p_reg;
@@ -110,6 +138,9 @@ extern int nes6502_execute(int total_cycles);
 extern void nes6502_nmi(void);
 extern void nes6502_irq(void);
 extern uint8 nes6502_getbyte(uint32 address);
+extern uint8 *nes6502_getptr(uint32 address);
+extern uint32 nes6502_getpc(void);
+extern int nes6502_idle(uint32 next_pc, int cycles);
 extern uint32 nes6502_getcycles(bool reset_flag);
 extern void nes6502_burn(int cycles);
 extern void nes6502_release(void);
@@ -117,9 +148,17 @@ extern void nes6502_release(void);
 /* Context get/set */
 extern void nes6502_setcontext(nes6502_context *cpu);
 extern void nes6502_getcontext(nes6502_context *cpu);
+extern void nes6502_setpage(int page, uint8 *ptr);
 extern void nes6502_clear_pending_irq(void);
 
-extern uint8 ext_irq_line;
+#ifdef NES6502_OPSTATS
+extern void nes6502_dumpopstats(const char *title);
+#endif /* NES6502_OPSTATS */
+#ifdef NES6502_PCPROF
+extern void nes6502_dumpprofile(const char *title, const uint8 *prg, uint32 prg_size);
+#endif /* NES6502_PCPROF */
+
+extern NES_LOCAL uint8 ext_irq_line;
 
 #ifdef __cplusplus
 }
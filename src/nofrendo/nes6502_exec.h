@@ -0,0 +1,1085 @@
+/*
+** Nofrendo (c) 1998-2000 Matthew Conte (matt@conte.com)
+**
+**
+** This program is free software; you can redistribute it and/or
+** modify it under the terms of version 2 of the GNU Library General 
+** Public License as published by the Free Software Foundation.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+**
+**
+** nes6502_exec.h
+**
+** 6502 opcode dispatch, included by nes6502.c once per core variant
+**
+** Every opcode is written once here in terms of the addressing mode
+** and instruction macros.  nes6502.c includes this file with those
+** macros bound to the batched, per-instruction cycle accounting and
+** again with them bound to per-cycle bus accesses, and NES6502_EXECUTE
+** names the function generated each time.  There is deliberately no
+** include guard.
+*/
+
+/* Execute instructions until count expires
+**
+** Returns the number of cycles *actually* executed, which will be
+** anywhere from zero to timeslice_cycles + 6
+*/
+static int NES6502_EXECUTE(int timeslice_cycles)
+{
+   int old_cycles = cpu.total_cycles;
+
+   uint32 temp, addr; /* for macros */
+   uint8 btemp, baddr; /* for macros */
+   uint8 data;
+#if NES6502_DCACHE
+   uint32 operand = 0; /* operand of the current instruction */
+#endif /* NES6502_DCACHE */
+
+   /* flags */
+   uint8 n_flag, v_flag, b_flag;
+   uint8 d_flag, i_flag, z_flag, c_flag;
+
+   /* local copies of regs */
+   uint32 PC;
+   uint8 A, X, Y, S;
+
+#ifdef NES6502_JUMPTABLE
+   
+   static const void *opcode_table[256] =
+   {
+      &&op00, &&op01, &&op02, &&op03, &&op04, &&op05, &&op06, &&op07,
+      &&op08, &&op09, &&op0A, &&op0B, &&op0C, &&op0D, &&op0E, &&op0F,
+      &&op10, &&op11, &&op12, &&op13, &&op14, &&op15, &&op16, &&op17,
+      &&op18, &&op19, &&op1A, &&op1B, &&op1C, &&op1D, &&op1E, &&op1F,
+      &&op20, &&op21, &&op22, &&op23, &&op24, &&op25, &&op26, &&op27,
+      &&op28, &&op29, &&op2A, &&op2B, &&op2C, &&op2D, &&op2E, &&op2F,
+      &&op30, &&op31, &&op32, &&op33, &&op34, &&op35, &&op36, &&op37,
+      &&op38, &&op39, &&op3A, &&op3B, &&op3C, &&op3D, &&op3E, &&op3F,
+      &&op40, &&op41, &&op42, &&op43, &&op44, &&op45, &&op46, &&op47,
+      &&op48, &&op49, &&op4A, &&op4B, &&op4C, &&op4D, &&op4E, &&op4F,
+      &&op50, &&op51, &&op52, &&op53, &&op54, &&op55, &&op56, &&op57,
+      &&op58, &&op59, &&op5A, &&op5B, &&op5C, &&op5D, &&op5E, &&op5F,
+      &&op60, &&op61, &&op62, &&op63, &&op64, &&op65, &&op66, &&op67,
+      &&op68, &&op69, &&op6A, &&op6B, &&op6C, &&op6D, &&op6E, &&op6F,
+      &&op70, &&op71, &&op72, &&op73, &&op74, &&op75, &&op76, &&op77,
+      &&op78, &&op79, &&op7A, &&op7B, &&op7C, &&op7D, &&op7E, &&op7F,
+      &&op80, &&op81, &&op82, &&op83, &&op84, &&op85, &&op86, &&op87,
+      &&op88, &&op89, &&op8A, &&op8B, &&op8C, &&op8D, &&op8E, &&op8F,
+      &&op90, &&op91, &&op92, &&op93, &&op94, &&op95, &&op96, &&op97,
+      &&op98, &&op99, &&op9A, &&op9B, &&op9C, &&op9D, &&op9E, &&op9F,
+      &&opA0, &&opA1, &&opA2, &&opA3, &&opA4, &&opA5, &&opA6, &&opA7,
+      &&opA8, &&opA9, &&opAA, &&opAB, &&opAC, &&opAD, &&opAE, &&opAF,
+      &&opB0, &&opB1, &&opB2, &&opB3, &&opB4, &&opB5, &&opB6, &&opB7,
+      &&opB8, &&opB9, &&opBA, &&opBB, &&opBC, &&opBD, &&opBE, &&opBF,
+      &&opC0, &&opC1, &&opC2, &&opC3, &&opC4, &&opC5, &&opC6, &&opC7,
+      &&opC8, &&opC9, &&opCA, &&opCB, &&opCC, &&opCD, &&opCE, &&opCF,
+      &&opD0, &&opD1, &&opD2, &&opD3, &&opD4, &&opD5, &&opD6, &&opD7,
+      &&opD8, &&opD9, &&opDA, &&opDB, &&opDC, &&opDD, &&opDE, &&opDF,
+      &&opE0, &&opE1, &&opE2, &&opE3, &&opE4, &&opE5, &&opE6, &&opE7,
+      &&opE8, &&opE9, &&opEA, &&opEB, &&opEC, &&opED, &&opEE, &&opEF,
+      &&opF0, &&opF1, &&opF2, &&opF3, &&opF4, &&opF5, &&opF6, &&opF7,
+      &&opF8, &&opF9, &&opFA, &&opFB, &&opFC, &&opFD, &&opFE, &&opFF
+   };
+
+#endif /* NES6502_JUMPTABLE */
+
+   remaining_cycles = timeslice_cycles;
+
+   GET_GLOBAL_REGS();
+   if (ext_irq_line && remaining_cycles > 0){
+      nes6502_irq();               /* level-triggered behaviour */
+   }
+
+   /* check for DMA cycle burning */
+   if (cpu.burn_cycles && remaining_cycles > 0)
+   {
+      int burn_for;
+      
+      burn_for = MIN(remaining_cycles, cpu.burn_cycles);
+      ADD_CYCLES(burn_for);
+      cpu.burn_cycles -= burn_for;
+   }
+
+   if (0 == i_flag && cpu.int_pending && remaining_cycles > 0)
+   {
+      cpu.int_pending = 0;
+      cpu.irq_was_requested = 0;
+      IRQ_PROC();
+      ADD_CYCLES(INT_CYCLES);
+   }
+
+   /* interrupts raised from here on are taken after the slice */
+   executing = true;
+
+#ifdef NES6502_JUMPTABLE
+   /* fetch first instruction */
+   OPCODE_END
+
+#else /* !NES6502_JUMPTABLE */
+
+   /* Continue until we run out of cycles */
+   while (remaining_cycles > 0)
+   {
+#ifdef NES6502_DISASM
+      log_printf(nes6502_disasm(PC, COMBINE_FLAGS(), A, X, Y, S));
+#endif /* NES6502_DISASM */
+      PROFILE_PC();
+
+      /* Fetch and execute instruction */
+      switch (COUNT_OPCODE(FETCH_OPCODE()))
+      {
+#endif /* !NES6502_JUMPTABLE */
+
+      OPCODE_BEGIN(00)  /* BRK */
+         BRK();
+         OPCODE_END
+
+      OPCODE_BEGIN(01)  /* ORA ($nn,X) */
+         ORA(6, INDIR_X_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(02)  /* JAM */
+      OPCODE_BEGIN(12)  /* JAM */
+      OPCODE_BEGIN(22)  /* JAM */
+      OPCODE_BEGIN(32)  /* JAM */
+      OPCODE_BEGIN(42)  /* JAM */
+      OPCODE_BEGIN(52)  /* JAM */
+      OPCODE_BEGIN(62)  /* JAM */
+      OPCODE_BEGIN(72)  /* JAM */
+      OPCODE_BEGIN(92)  /* JAM */
+      OPCODE_BEGIN(B2)  /* JAM */
+      OPCODE_BEGIN(D2)  /* JAM */
+      OPCODE_BEGIN(F2)  /* JAM */
+         JAM();
+         /* kill the CPU */
+         remaining_cycles = 0;
+         OPCODE_END
+
+      OPCODE_BEGIN(03)  /* SLO ($nn,X) */
+         SLO(8, INDIR_X, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(04)  /* NOP $nn */
+      OPCODE_BEGIN(44)  /* NOP $nn */
+      OPCODE_BEGIN(64)  /* NOP $nn */
+         DOP(3);
+         OPCODE_END
+
+      OPCODE_BEGIN(05)  /* ORA $nn */
+         ORA(3, ZERO_PAGE_BYTE); 
+         OPCODE_END
+
+      OPCODE_BEGIN(06)  /* ASL $nn */
+         ASL(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(07)  /* SLO $nn */
+         SLO(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(08)  /* PHP */
+         PHP(); 
+         OPCODE_END
+
+      OPCODE_BEGIN(09)  /* ORA #$nn */
+         ORA(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(0A)  /* ASL A */
+         ASL_A();
+         OPCODE_END
+
+      OPCODE_BEGIN(0B)  /* ANC #$nn */
+         ANC(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(0C)  /* NOP $nnnn */
+         TOP(); 
+         OPCODE_END
+
+      OPCODE_BEGIN(0D)  /* ORA $nnnn */
+         ORA(4, ABSOLUTE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(0E)  /* ASL $nnnn */
+         ASL(6, ABSOLUTE, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(0F)  /* SLO $nnnn */
+         SLO(6, ABSOLUTE, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(10)  /* BPL $nnnn */
+         BPL();
+         OPCODE_END
+
+      OPCODE_BEGIN(11)  /* ORA ($nn),Y */
+         ORA(5, INDIR_Y_BYTE_READ);
+         OPCODE_END
+      
+      OPCODE_BEGIN(13)  /* SLO ($nn),Y */
+         SLO(8, INDIR_Y, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(14)  /* NOP $nn,X */
+      OPCODE_BEGIN(34)  /* NOP */
+      OPCODE_BEGIN(54)  /* NOP $nn,X */
+      OPCODE_BEGIN(74)  /* NOP $nn,X */
+      OPCODE_BEGIN(D4)  /* NOP $nn,X */
+      OPCODE_BEGIN(F4)  /* NOP ($nn,X) */
+         DOP(4);
+         OPCODE_END
+
+      OPCODE_BEGIN(15)  /* ORA $nn,X */
+         ORA(4, ZP_IND_X_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(16)  /* ASL $nn,X */
+         ASL(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(17)  /* SLO $nn,X */
+         SLO(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(18)  /* CLC */
+         CLC();
+         OPCODE_END
+
+      OPCODE_BEGIN(19)  /* ORA $nnnn,Y */
+         ORA(4, ABS_IND_Y_BYTE_READ);
+         OPCODE_END
+      
+      OPCODE_BEGIN(1A)  /* NOP */
+      OPCODE_BEGIN(3A)  /* NOP */
+      OPCODE_BEGIN(5A)  /* NOP */
+      OPCODE_BEGIN(7A)  /* NOP */
+      OPCODE_BEGIN(DA)  /* NOP */
+      OPCODE_BEGIN(FA)  /* NOP */
+         NOP();
+         OPCODE_END
+
+      OPCODE_BEGIN(1B)  /* SLO $nnnn,Y */
+         SLO(7, ABS_IND_Y, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(1C)  /* NOP $nnnn,X */
+      OPCODE_BEGIN(3C)  /* NOP $nnnn,X */
+      OPCODE_BEGIN(5C)  /* NOP $nnnn,X */
+      OPCODE_BEGIN(7C)  /* NOP $nnnn,X */
+      OPCODE_BEGIN(DC)  /* NOP $nnnn,X */
+      OPCODE_BEGIN(FC)  /* NOP $nnnn,X */
+         TOP();
+         OPCODE_END
+
+      OPCODE_BEGIN(1D)  /* ORA $nnnn,X */
+         ORA(4, ABS_IND_X_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(1E)  /* ASL $nnnn,X */
+         ASL(7, ABS_IND_X, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(1F)  /* SLO $nnnn,X */
+         SLO(7, ABS_IND_X, mem_writebyte, addr);
+         OPCODE_END
+      
+      OPCODE_BEGIN(20)  /* JSR $nnnn */
+         JSR();
+         OPCODE_END
+
+      OPCODE_BEGIN(21)  /* AND ($nn,X) */
+         AND(6, INDIR_X_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(23)  /* RLA ($nn,X) */
+         RLA(8, INDIR_X, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(24)  /* BIT $nn */
+         BIT(3, ZERO_PAGE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(25)  /* AND $nn */
+         AND(3, ZERO_PAGE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(26)  /* ROL $nn */
+         ROL(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(27)  /* RLA $nn */
+         RLA(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(28)  /* PLP */
+         PLP();
+         OPCODE_END
+
+      OPCODE_BEGIN(29)  /* AND #$nn */
+         AND(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(2A)  /* ROL A */
+         ROL_A();
+         OPCODE_END
+
+      OPCODE_BEGIN(2B)  /* ANC #$nn */
+         ANC(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(2C)  /* BIT $nnnn */
+         BIT(4, ABSOLUTE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(2D)  /* AND $nnnn */
+         AND(4, ABSOLUTE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(2E)  /* ROL $nnnn */
+         ROL(6, ABSOLUTE, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(2F)  /* RLA $nnnn */
+         RLA(6, ABSOLUTE, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(30)  /* BMI $nnnn */
+         BMI();
+         OPCODE_END
+
+      OPCODE_BEGIN(31)  /* AND ($nn),Y */
+         AND(5, INDIR_Y_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(33)  /* RLA ($nn),Y */
+         RLA(8, INDIR_Y, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(35)  /* AND $nn,X */
+         AND(4, ZP_IND_X_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(36)  /* ROL $nn,X */
+         ROL(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(37)  /* RLA $nn,X */
+         RLA(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(38)  /* SEC */
+         SEC();
+         OPCODE_END
+
+      OPCODE_BEGIN(39)  /* AND $nnnn,Y */
+         AND(4, ABS_IND_Y_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(3B)  /* RLA $nnnn,Y */
+         RLA(7, ABS_IND_Y, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(3D)  /* AND $nnnn,X */
+         AND(4, ABS_IND_X_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(3E)  /* ROL $nnnn,X */
+         ROL(7, ABS_IND_X, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(3F)  /* RLA $nnnn,X */
+         RLA(7, ABS_IND_X, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(40)  /* RTI */
+         RTI();
+         OPCODE_END
+
+      OPCODE_BEGIN(41)  /* EOR ($nn,X) */
+         EOR(6, INDIR_X_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(43)  /* SRE ($nn,X) */
+         SRE(8, INDIR_X, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(45)  /* EOR $nn */
+         EOR(3, ZERO_PAGE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(46)  /* LSR $nn */
+         LSR(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(47)  /* SRE $nn */
+         SRE(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(48)  /* PHA */
+         PHA();
+         OPCODE_END
+
+      OPCODE_BEGIN(49)  /* EOR #$nn */
+         EOR(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(4A)  /* LSR A */
+         LSR_A();
+         OPCODE_END
+
+      OPCODE_BEGIN(4B)  /* ASR #$nn */
+         ASR(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(4C)  /* JMP $nnnn */
+         JMP_ABSOLUTE();
+         OPCODE_END
+
+      OPCODE_BEGIN(4D)  /* EOR $nnnn */
+         EOR(4, ABSOLUTE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(4E)  /* LSR $nnnn */
+         LSR(6, ABSOLUTE, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(4F)  /* SRE $nnnn */
+         SRE(6, ABSOLUTE, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(50)  /* BVC $nnnn */
+         BVC();
+         OPCODE_END
+
+      OPCODE_BEGIN(51)  /* EOR ($nn),Y */
+         EOR(5, INDIR_Y_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(53)  /* SRE ($nn),Y */
+         SRE(8, INDIR_Y, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(55)  /* EOR $nn,X */
+         EOR(4, ZP_IND_X_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(56)  /* LSR $nn,X */
+         LSR(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(57)  /* SRE $nn,X */
+         SRE(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(58)  /* CLI */
+         CLI();
+         OPCODE_END
+
+      OPCODE_BEGIN(59)  /* EOR $nnnn,Y */
+         EOR(4, ABS_IND_Y_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(5B)  /* SRE $nnnn,Y */
+         SRE(7, ABS_IND_Y, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(5D)  /* EOR $nnnn,X */
+         EOR(4, ABS_IND_X_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(5E)  /* LSR $nnnn,X */
+         LSR(7, ABS_IND_X, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(5F)  /* SRE $nnnn,X */
+         SRE(7, ABS_IND_X, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(60)  /* RTS */
+         RTS();
+         OPCODE_END
+
+      OPCODE_BEGIN(61)  /* ADC ($nn,X) */
+         ADC(6, INDIR_X_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(63)  /* RRA ($nn,X) */
+         RRA(8, INDIR_X, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(65)  /* ADC $nn */
+         ADC(3, ZERO_PAGE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(66)  /* ROR $nn */
+         ROR(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(67)  /* RRA $nn */
+         RRA(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(68)  /* PLA */
+         PLA();
+         OPCODE_END
+
+      OPCODE_BEGIN(69)  /* ADC #$nn */
+         ADC(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(6A)  /* ROR A */
+         ROR_A();
+         OPCODE_END
+
+      OPCODE_BEGIN(6B)  /* ARR #$nn */
+         ARR(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(6C)  /* JMP ($nnnn) */
+         JMP_INDIRECT();
+         OPCODE_END
+
+      OPCODE_BEGIN(6D)  /* ADC $nnnn */
+         ADC(4, ABSOLUTE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(6E)  /* ROR $nnnn */
+         ROR(6, ABSOLUTE, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(6F)  /* RRA $nnnn */
+         RRA(6, ABSOLUTE, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(70)  /* BVS $nnnn */
+         BVS();
+         OPCODE_END
+
+      OPCODE_BEGIN(71)  /* ADC ($nn),Y */
+         ADC(5, INDIR_Y_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(73)  /* RRA ($nn),Y */
+         RRA(8, INDIR_Y, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(75)  /* ADC $nn,X */
+         ADC(4, ZP_IND_X_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(76)  /* ROR $nn,X */
+         ROR(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(77)  /* RRA $nn,X */
+         RRA(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(78)  /* SEI */
+         SEI();
+         OPCODE_END
+
+      OPCODE_BEGIN(79)  /* ADC $nnnn,Y */
+         ADC(4, ABS_IND_Y_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(7B)  /* RRA $nnnn,Y */
+         RRA(7, ABS_IND_Y, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(7D)  /* ADC $nnnn,X */
+         ADC(4, ABS_IND_X_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(7E)  /* ROR $nnnn,X */
+         ROR(7, ABS_IND_X, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(7F)  /* RRA $nnnn,X */
+         RRA(7, ABS_IND_X, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(80)  /* NOP #$nn */
+      OPCODE_BEGIN(82)  /* NOP #$nn */
+      OPCODE_BEGIN(89)  /* NOP #$nn */
+      OPCODE_BEGIN(C2)  /* NOP #$nn */
+      OPCODE_BEGIN(E2)  /* NOP #$nn */
+         DOP(2);
+         OPCODE_END
+
+      OPCODE_BEGIN(81)  /* STA ($nn,X) */
+         STA(6, INDIR_X_ADDR, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(83)  /* SAX ($nn,X) */
+         SAX(6, INDIR_X_ADDR, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(84)  /* STY $nn */
+         STY(3, ZERO_PAGE_ADDR, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(85)  /* STA $nn */
+         STA(3, ZERO_PAGE_ADDR, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(86)  /* STX $nn */
+         STX(3, ZERO_PAGE_ADDR, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(87)  /* SAX $nn */
+         SAX(3, ZERO_PAGE_ADDR, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(88)  /* DEY */
+         DEY();
+         OPCODE_END
+
+      OPCODE_BEGIN(8A)  /* TXA */
+         TXA();
+         OPCODE_END
+
+      OPCODE_BEGIN(8B)  /* ANE #$nn */
+         ANE(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(8C)  /* STY $nnnn */
+         STY(4, ABSOLUTE_ADDR, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(8D)  /* STA $nnnn */
+         STA(4, ABSOLUTE_ADDR, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(8E)  /* STX $nnnn */
+         STX(4, ABSOLUTE_ADDR, mem_writebyte, addr);
+         OPCODE_END
+      
+      OPCODE_BEGIN(8F)  /* SAX $nnnn */
+         SAX(4, ABSOLUTE_ADDR, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(90)  /* BCC $nnnn */
+         BCC();
+         OPCODE_END
+
+      OPCODE_BEGIN(91)  /* STA ($nn),Y */
+         STA(6, INDIR_Y_ADDR, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(93)  /* SHA ($nn),Y */
+         SHA(6, INDIR_Y_ADDR, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(94)  /* STY $nn,X */
+         STY(4, ZP_IND_X_ADDR, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(95)  /* STA $nn,X */
+         STA(4, ZP_IND_X_ADDR, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(96)  /* STX $nn,Y */
+         STX(4, ZP_IND_Y_ADDR, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(97)  /* SAX $nn,Y */
+         SAX(4, ZP_IND_Y_ADDR, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(98)  /* TYA */
+         TYA();
+         OPCODE_END
+
+      OPCODE_BEGIN(99)  /* STA $nnnn,Y */
+         STA(5, ABS_IND_Y_ADDR, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(9A)  /* TXS */
+         TXS();
+         OPCODE_END
+
+      OPCODE_BEGIN(9B)  /* SHS $nnnn,Y */
+         SHS(5, ABS_IND_Y_ADDR, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(9C)  /* SHY $nnnn,X */
+         SHY(5, ABS_IND_X_ADDR, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(9D)  /* STA $nnnn,X */
+         STA(5, ABS_IND_X_ADDR, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(9E)  /* SHX $nnnn,Y */
+         SHX(5, ABS_IND_Y_ADDR, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(9F)  /* SHA $nnnn,Y */
+         SHA(5, ABS_IND_Y_ADDR, mem_writebyte, addr);
+         OPCODE_END
+      
+      OPCODE_BEGIN(A0)  /* LDY #$nn */
+         LDY(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(A1)  /* LDA ($nn,X) */
+         LDA(6, INDIR_X_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(A2)  /* LDX #$nn */
+         LDX(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(A3)  /* LAX ($nn,X) */
+         LAX(6, INDIR_X_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(A4)  /* LDY $nn */
+         LDY(3, ZERO_PAGE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(A5)  /* LDA $nn */
+         LDA(3, ZERO_PAGE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(A6)  /* LDX $nn */
+         LDX(3, ZERO_PAGE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(A7)  /* LAX $nn */
+         LAX(3, ZERO_PAGE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(A8)  /* TAY */
+         TAY();
+         OPCODE_END
+
+      OPCODE_BEGIN(A9)  /* LDA #$nn */
+         LDA(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(AA)  /* TAX */
+         TAX();
+         OPCODE_END
+
+      OPCODE_BEGIN(AB)  /* LXA #$nn */
+         LXA(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(AC)  /* LDY $nnnn */
+         LDY(4, ABSOLUTE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(AD)  /* LDA $nnnn */
+         LDA(4, ABSOLUTE_BYTE);
+         OPCODE_END
+      
+      OPCODE_BEGIN(AE)  /* LDX $nnnn */
+         LDX(4, ABSOLUTE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(AF)  /* LAX $nnnn */
+         LAX(4, ABSOLUTE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(B0)  /* BCS $nnnn */
+         BCS();
+         OPCODE_END
+
+      OPCODE_BEGIN(B1)  /* LDA ($nn),Y */
+         LDA(5, INDIR_Y_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(B3)  /* LAX ($nn),Y */
+         LAX(5, INDIR_Y_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(B4)  /* LDY $nn,X */
+         LDY(4, ZP_IND_X_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(B5)  /* LDA $nn,X */
+         LDA(4, ZP_IND_X_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(B6)  /* LDX $nn,Y */
+         LDX(4, ZP_IND_Y_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(B7)  /* LAX $nn,Y */
+         LAX(4, ZP_IND_Y_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(B8)  /* CLV */
+         CLV();
+         OPCODE_END
+
+      OPCODE_BEGIN(B9)  /* LDA $nnnn,Y */
+         LDA(4, ABS_IND_Y_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(BA)  /* TSX */
+         TSX();
+         OPCODE_END
+
+      OPCODE_BEGIN(BB)  /* LAS $nnnn,Y */
+         LAS(4, ABS_IND_Y_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(BC)  /* LDY $nnnn,X */
+         LDY(4, ABS_IND_X_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(BD)  /* LDA $nnnn,X */
+         LDA(4, ABS_IND_X_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(BE)  /* LDX $nnnn,Y */
+         LDX(4, ABS_IND_Y_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(BF)  /* LAX $nnnn,Y */
+         LAX(4, ABS_IND_Y_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(C0)  /* CPY #$nn */
+         CPY(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(C1)  /* CMP ($nn,X) */
+         CMP(6, INDIR_X_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(C3)  /* DCP ($nn,X) */
+         DCP(8, INDIR_X, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(C4)  /* CPY $nn */
+         CPY(3, ZERO_PAGE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(C5)  /* CMP $nn */
+         CMP(3, ZERO_PAGE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(C6)  /* DEC $nn */
+         DEC(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(C7)  /* DCP $nn */
+         DCP(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(C8)  /* INY */
+         INY();
+         OPCODE_END
+
+      OPCODE_BEGIN(C9)  /* CMP #$nn */
+         CMP(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(CA)  /* DEX */
+         DEX();
+         OPCODE_END
+
+      OPCODE_BEGIN(CB)  /* SBX #$nn */
+         SBX(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(CC)  /* CPY $nnnn */
+         CPY(4, ABSOLUTE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(CD)  /* CMP $nnnn */
+         CMP(4, ABSOLUTE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(CE)  /* DEC $nnnn */
+         DEC(6, ABSOLUTE, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(CF)  /* DCP $nnnn */
+         DCP(6, ABSOLUTE, mem_writebyte, addr);
+         OPCODE_END
+      
+      OPCODE_BEGIN(D0)  /* BNE $nnnn */
+         BNE();
+         OPCODE_END
+
+      OPCODE_BEGIN(D1)  /* CMP ($nn),Y */
+         CMP(5, INDIR_Y_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(D3)  /* DCP ($nn),Y */
+         DCP(8, INDIR_Y, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(D5)  /* CMP $nn,X */
+         CMP(4, ZP_IND_X_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(D6)  /* DEC $nn,X */
+         DEC(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(D7)  /* DCP $nn,X */
+         DCP(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(D8)  /* CLD */
+         CLD();
+         OPCODE_END
+
+      OPCODE_BEGIN(D9)  /* CMP $nnnn,Y */
+         CMP(4, ABS_IND_Y_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(DB)  /* DCP $nnnn,Y */
+         DCP(7, ABS_IND_Y, mem_writebyte, addr);
+         OPCODE_END                  
+
+      OPCODE_BEGIN(DD)  /* CMP $nnnn,X */
+         CMP(4, ABS_IND_X_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(DE)  /* DEC $nnnn,X */
+         DEC(7, ABS_IND_X, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(DF)  /* DCP $nnnn,X */
+         DCP(7, ABS_IND_X, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(E0)  /* CPX #$nn */
+         CPX(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(E1)  /* SBC ($nn,X) */
+         SBC(6, INDIR_X_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(E3)  /* ISB ($nn,X) */
+         ISB(8, INDIR_X, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(E4)  /* CPX $nn */
+         CPX(3, ZERO_PAGE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(E5)  /* SBC $nn */
+         SBC(3, ZERO_PAGE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(E6)  /* INC $nn */
+         INC(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(E7)  /* ISB $nn */
+         ISB(5, ZERO_PAGE, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(E8)  /* INX */
+         INX();
+         OPCODE_END
+
+      OPCODE_BEGIN(E9)  /* SBC #$nn */
+      OPCODE_BEGIN(EB)  /* USBC #$nn */
+         SBC(2, IMMEDIATE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(EA)  /* NOP */
+         NOP();
+         OPCODE_END
+
+      OPCODE_BEGIN(EC)  /* CPX $nnnn */
+         CPX(4, ABSOLUTE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(ED)  /* SBC $nnnn */
+         SBC(4, ABSOLUTE_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(EE)  /* INC $nnnn */
+         INC(6, ABSOLUTE, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(EF)  /* ISB $nnnn */
+         ISB(6, ABSOLUTE, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(F0)  /* BEQ $nnnn */
+         BEQ();
+         OPCODE_END
+
+      OPCODE_BEGIN(F1)  /* SBC ($nn),Y */
+         SBC(5, INDIR_Y_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(F3)  /* ISB ($nn),Y */
+         ISB(8, INDIR_Y, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(F5)  /* SBC $nn,X */
+         SBC(4, ZP_IND_X_BYTE);
+         OPCODE_END
+
+      OPCODE_BEGIN(F6)  /* INC $nn,X */
+         INC(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(F7)  /* ISB $nn,X */
+         ISB(6, ZP_IND_X, ZP_WRITEBYTE, baddr);
+         OPCODE_END
+
+      OPCODE_BEGIN(F8)  /* SED */
+         SED();
+         OPCODE_END
+
+      OPCODE_BEGIN(F9)  /* SBC $nnnn,Y */
+         SBC(4, ABS_IND_Y_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(FB)  /* ISB $nnnn,Y */
+         ISB(7, ABS_IND_Y, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(FD)  /* SBC $nnnn,X */
+         SBC(4, ABS_IND_X_BYTE_READ);
+         OPCODE_END
+
+      OPCODE_BEGIN(FE)  /* INC $nnnn,X */
+         INC(7, ABS_IND_X, mem_writebyte, addr);
+         OPCODE_END
+
+      OPCODE_BEGIN(FF)  /* ISB $nnnn,X */
+         ISB(7, ABS_IND_X, mem_writebyte, addr);
+         OPCODE_END
+
+#ifdef NES6502_JUMPTABLE
+end_execute:
+
+#else /* !NES6502_JUMPTABLE */
+      }
+   }
+#endif /* !NES6502_JUMPTABLE */
+
+   executing = false;
+
+   /* store local copy of regs */
+   STORE_LOCAL_REGS();
+
+   /* Return our actual amount of executed cycles */
+   return (cpu.total_cycles - old_cycles);
+}
@@ -30,29 +30,43 @@
 #include "nes6502.h"
  
 
-#define  APU_OVERSAMPLE
 #define  APU_VOLUME_DECAY(x)  ((x) -= ((x) >> 7))
 
-/* the following seem to be the correct (empirically determined)
-** relative volumes between the sound channels
+/* whole cpu cycles in channel timer units */
+#if APU_FIXED
+#define  APU_CYCLES(x)  ((apu_time_t) (x) << APU_FRAC_BITS)
+#else /* !APU_FIXED */
+#define  APU_CYCLES(x)  ((apu_time_t) (x))
+#endif /* !APU_FIXED */
+
+/* band-limited synthesis: the channels add each change of their output
+** level to a delta buffer, at the cycle it happens, as a windowed sinc
+** pulse; apu_process integrates the buffer into the output samples.
+** the pulses share one buffer and the triangle, noise and dmc another,
+** as the mixer is nonlinear within each group
 */
-#define  APU_RECTANGLE_OUTPUT(channel) (apu.rectangle[channel].output_vol)
-#define  APU_TRIANGLE_OUTPUT           (apu.triangle.output_vol + (apu.triangle.output_vol >> 2))
-#define  APU_NOISE_OUTPUT              ((apu.noise.output_vol + apu.noise.output_vol + apu.noise.output_vol) >> 2)
-#define  APU_DMC_OUTPUT                ((apu.dmc.output_vol + apu.dmc.output_vol + apu.dmc.output_vol) >> 2)
+#define  APU_BLEP_PHASES  32    /* pulse positions within a sample */
+#define  APU_BLEP_TAPS    16    /* samples a pulse is spread over */
+#define  APU_BLEP_BITS    14    /* kernels sum to 1 << APU_BLEP_BITS */
+#define  APU_BLOCK        512   /* samples synthesized per pass */
+#define  APU_BLEP_BUFSIZE (APU_BLOCK + APU_BLEP_TAPS)
 
 /* active APU */
-static apu_t apu;
+static NES_LOCAL apu_t apu;
 
 /* look up table madness */
-static int32 decay_lut[16];
-static int vbl_lut[32];
-static int trilength_lut[128];
+static NES_LOCAL int32 decay_lut[16];
+static NES_LOCAL int vbl_lut[32];
+static NES_LOCAL int trilength_lut[128];
+
+/* mixer output by pulse 1 + pulse 2, and by triangle * 3 + noise * 2 + dmc */
+static NES_LOCAL int32 pulse_lut[32];
+static NES_LOCAL int32 tnd_lut[204];
 
 /* noise lookups for both modes */
 #ifndef REALTIME_NOISE
-static int8 noise_long_lut[APU_NOISE_32K];
-static int8 noise_short_lut[APU_NOISE_93];
+static NES_LOCAL int8 noise_long_lut[APU_NOISE_32K];
+static NES_LOCAL int8 noise_short_lut[APU_NOISE_93];
 #endif /* !REALTIME_NOISE */
 
 
@@ -100,6 +114,45 @@ const int dmc_clocks[16] =
 /* ratios of pos/neg pulse for rectangle waves */
 static const int duty_flip[4] = { 2, 4, 8, 12 };
 
+/* Blackman windowed sinc pulses, cut off at 0.45 of the sample rate;
+** tap i of kernel p is centred on i = 7 + p / APU_BLEP_PHASES
+*/
+static const int16 blep_kernel[APU_BLEP_PHASES][APU_BLEP_TAPS] =
+{
+   {     9,   -55,   180,  -422,   780, -1186,  1513, 14746,  1513, -1186,   780,  -422,   180,   -55,     9,     0 },
+   {     9,   -54,   173,  -397,   711, -1013,  1058, 14725,  1987, -1357,   847,  -443,   184,   -55,     9,     0 },
+   {     8,   -53,   166,  -371,   638,  -840,   626, 14666,  2480, -1525,   909,  -462,   188,   -55,     9,     0 },
+   {     8,   -51,   158,  -343,   564,  -668,   217, 14567,  2990, -1689,   966,  -478,   190,   -55,     8,     0 },
+   {     8,   -49,   148,  -314,   488,  -498,  -168, 14428,  3515, -1846,  1018,  -491,   190,   -53,     8,     0 },
+   {     7,   -46,   139,  -283,   412,  -333,  -527, 14250,  4053, -1996,  1063,  -500,   189,   -51,     7,     0 },
+   {     7,   -44,   128,  -252,   336,  -172,  -861, 14036,  4602, -2136,  1102,  -505,   186,   -49,     6,     0 },
+   {     6,   -41,   117,  -220,   261,   -17, -1167, 13783,  5159, -2266,  1133,  -505,   181,   -45,     5,     0 },
+   {     6,   -38,   106,  -188,   187,   131, -1446, 13495,  5722, -2382,  1156,  -502,   174,   -41,     4,     0 },
+   {     5,   -35,    94,  -156,   115,   272, -1697, 13176,  6288, -2485,  1170,  -494,   165,   -37,     3,     0 },
+   {     5,   -31,    82,  -124,    45,   403, -1920, 12823,  6856, -2572,  1174,  -481,   154,   -31,     1,     0 },
+   {     4,   -28,    71,   -93,   -22,   526, -2115, 12439,  7423, -2642,  1169,  -463,   141,   -25,    -1,     0 },
+   {     4,   -25,    59,   -63,   -86,   639, -2283, 12027,  7985, -2693,  1154,  -440,   126,   -18,    -3,     1 },
+   {     3,   -22,    48,   -34,  -145,   741, -2423, 11591,  8540, -2724,  1128,  -413,   108,   -10,    -5,     1 },
+   {     3,   -19,    37,    -6,  -201,   833, -2536, 11128,  9087, -2734,  1091,  -380,    89,    -2,    -7,     1 },
+   {     2,   -16,    27,    20,  -253,   914, -2623, 10647,  9621, -2721,  1043,  -343,    68,     7,   -10,     1 },
+   {     2,   -13,    17,    45,  -300,   984, -2684, 10141, 10141, -2684,   984,  -300,    45,    17,   -13,     2 },
+   {     1,   -10,     7,    68,  -343,  1043, -2721,  9621, 10647, -2623,   914,  -253,    20,    27,   -16,     2 },
+   {     1,    -7,    -2,    89,  -380,  1091, -2734,  9087, 11128, -2536,   833,  -201,    -6,    37,   -19,     3 },
+   {     1,    -5,   -10,   108,  -413,  1128, -2724,  8540, 11591, -2423,   741,  -145,   -34,    48,   -22,     3 },
+   {     1,    -3,   -18,   126,  -440,  1154, -2693,  7985, 12027, -2283,   639,   -86,   -63,    59,   -25,     4 },
+   {     0,    -1,   -25,   141,  -463,  1169, -2642,  7423, 12439, -2115,   526,   -22,   -93,    71,   -28,     4 },
+   {     0,     1,   -31,   154,  -481,  1174, -2572,  6856, 12823, -1920,   403,    45,  -124,    82,   -31,     5 },
+   {     0,     3,   -37,   165,  -494,  1170, -2485,  6288, 13176, -1697,   272,   115,  -156,    94,   -35,     5 },
+   {     0,     4,   -41,   174,  -502,  1156, -2382,  5722, 13495, -1446,   131,   187,  -188,   106,   -38,     6 },
+   {     0,     5,   -45,   181,  -505,  1133, -2266,  5159, 13783, -1167,   -17,   261,  -220,   117,   -41,     6 },
+   {     0,     6,   -49,   186,  -505,  1102, -2136,  4602, 14036,  -861,  -172,   336,  -252,   128,   -44,     7 },
+   {     0,     7,   -51,   189,  -500,  1063, -1996,  4053, 14250,  -527,  -333,   412,  -283,   139,   -46,     7 },
+   {     0,     8,   -53,   190,  -491,  1018, -1846,  3515, 14428,  -168,  -498,   488,  -314,   148,   -49,     8 },
+   {     0,     8,   -55,   190,  -478,   966, -1689,  2990, 14567,   217,  -668,   564,  -343,   158,   -51,     8 },
+   {     0,     9,   -55,   188,  -462,   909, -1525,  2480, 14666,   626,  -840,   638,  -371,   166,   -53,     8 },
+   {     0,     9,   -55,   184,  -443,   847, -1357,  1987, 14725,  1058, -1013,   711,  -397,   173,   -54,     9 },
+};
+
 
 void apu_setcontext(apu_t *src_apu)
 {
@@ -126,7 +179,7 @@ void apu_setchan(int chan, bool enabled)
 #ifdef REALTIME_NOISE
 INLINE int8 shift_register15(uint8 xor_tap)
 {
-   static int sreg = 0x4000;
+   static NES_LOCAL int sreg = 0x4000;
    int bit0, tap, bit14;
 
    bit0 = sreg & 1;
@@ -139,7 +192,7 @@ INLINE int8 shift_register15(uint8 xor_tap)
 #else /* !REALTIME_NOISE */
 static void shift_register15(int8 *buf, int count)
 {
-   static int sreg = 0x4000;
+   static NES_LOCAL int sreg = 0x4000;
    int bit0, bit1, bit6, bit14;
 
    if (count == APU_NOISE_93)
@@ -169,6 +222,32 @@ static void shift_register15(int8 *buf, int count)
 }
 #endif /* !REALTIME_NOISE */
 
+/* add a step of delta to buf, offset cycles into the block */
+INLINE void apu_blep(int32 *buf, apu_time_t offset, int32 delta)
+{
+#if APU_FIXED
+   int pos = (int) (((uint64_t) offset * apu.blep_scale) >> 32);
+#else /* !APU_FIXED */
+   int pos = (int) (offset * apu.blep_scale);
+#endif /* !APU_FIXED */
+   const int16 *kernel = blep_kernel[pos & (APU_BLEP_PHASES - 1)];
+   int32 *out = buf + pos / APU_BLEP_PHASES;
+   int i;
+
+   for (i = 0; i < APU_BLEP_TAPS; i++)
+      out[i] += kernel[i] * delta;
+}
+
+/* move a channel's output to level, offset cycles into the block */
+INLINE void apu_level(int32 *buf, int32 *output_vol, int32 level, apu_time_t offset)
+{
+   if (level != *output_vol)
+   {
+      apu_blep(buf, offset, level - *output_vol);
+      *output_vol = level;
+   }
+}
+
 /* RECTANGLE WAVE
 ** ==============
 ** reg0: 0-3=volume, 4=envelope, 5=hold, 6-7=duty cycle
@@ -176,172 +255,127 @@ static void shift_register15(int8 *buf, int count)
 ** reg2: 8 bits of freq
 ** reg3: 0-2=high freq, 7-4=vbl length counter
 */
-#ifdef APU_OVERSAMPLE
+static void apu_rectangle_run(rectangle_t *chan, apu_time_t offset, int count)
+{
+   apu_time_t limit = count * apu.sample_cycles;
+   apu_time_t edge, period;
+   int32 output;
+   int steps;
 
-#define  APU_MAKE_RECTANGLE(ch) \
-static int32 apu_rectangle_##ch(void) \
-{ \
-   int32 output, total; \
-   int num_times; \
-\
-   APU_VOLUME_DECAY(apu.rectangle[ch].output_vol); \
-\
-   if (false == apu.rectangle[ch].enabled || 0 == apu.rectangle[ch].vbl_length) \
-      return APU_RECTANGLE_OUTPUT(ch); \
-\
-   /* vbl length counter */ \
-   if (false == apu.rectangle[ch].holdnote) \
-      apu.rectangle[ch].vbl_length--; \
-\
-   /* envelope decay at a rate of (env_delay + 1) / 240 secs */ \
-   apu.rectangle[ch].env_phase -= 4; /* 240/60 */ \
-   while (apu.rectangle[ch].env_phase < 0) \
-   { \
-      apu.rectangle[ch].env_phase += apu.rectangle[ch].env_delay; \
-\
-      if (apu.rectangle[ch].holdnote) \
-         apu.rectangle[ch].env_vol = (apu.rectangle[ch].env_vol + 1) & 0x0F; \
-      else if (apu.rectangle[ch].env_vol < 0x0F) \
-         apu.rectangle[ch].env_vol++; \
-   } \
-\
-   /* TODO: find true relation of freq_limit to register values */ \
-   if (apu.rectangle[ch].freq < 8 \
-       || (false == apu.rectangle[ch].sweep_inc \
-           && apu.rectangle[ch].freq > apu.rectangle[ch].freq_limit)) \
-      return APU_RECTANGLE_OUTPUT(ch); \
-\
-   /* frequency sweeping at a rate of (sweep_delay + 1) / 120 secs */ \
-   if (apu.rectangle[ch].sweep_on && apu.rectangle[ch].sweep_shifts) \
-   { \
-      apu.rectangle[ch].sweep_phase -= 2; /* 120/60 */ \
-      while (apu.rectangle[ch].sweep_phase < 0) \
-      { \
-         apu.rectangle[ch].sweep_phase += apu.rectangle[ch].sweep_delay; \
-\
-         if (apu.rectangle[ch].sweep_inc) /* ramp up */ \
-         { \
-            if (0 == ch) \
-               apu.rectangle[ch].freq += ~(apu.rectangle[ch].freq >> apu.rectangle[ch].sweep_shifts); \
-            else \
-               apu.rectangle[ch].freq -= (apu.rectangle[ch].freq >> apu.rectangle[ch].sweep_shifts); \
-         } \
-         else /* ramp down */ \
-         { \
-            apu.rectangle[ch].freq += (apu.rectangle[ch].freq >> apu.rectangle[ch].sweep_shifts); \
-         } \
-      } \
-   } \
-\
-   apu.rectangle[ch].accum -= apu.cycle_rate; \
-   if (apu.rectangle[ch].accum >= 0) \
-      return APU_RECTANGLE_OUTPUT(ch); \
-\
-   if (apu.rectangle[ch].fixed_envelope) \
-      output = apu.rectangle[ch].volume << 8; /* fixed volume */ \
-   else \
-      output = (apu.rectangle[ch].env_vol ^ 0x0F) << 8; \
-\
-   num_times = total = 0; \
-\
-   while (apu.rectangle[ch].accum < 0) \
-   { \
-      apu.rectangle[ch].accum += apu.rectangle[ch].freq + 1; \
-      apu.rectangle[ch].adder = (apu.rectangle[ch].adder + 1) & 0x0F; \
-\
-      if (apu.rectangle[ch].adder < apu.rectangle[ch].duty_flip) \
-         total += output; \
-      else \
-         total -= output; \
-\
-      num_times++; \
-   } \
-\
-   apu.rectangle[ch].output_vol = total / num_times; \
-   return APU_RECTANGLE_OUTPUT(ch); \
-} 
-
-#else /* !APU_OVERSAMPLE */
-#define  APU_MAKE_RECTANGLE(ch) \
-static int32 apu_rectangle_##ch(void) \
-{ \
-   int32 output; \
-\
-   APU_VOLUME_DECAY(apu.rectangle[ch].output_vol); \
-\
-   if (false == apu.rectangle[ch].enabled || 0 == apu.rectangle[ch].vbl_length) \
-      return APU_RECTANGLE_OUTPUT(ch); \
-\
-   /* vbl length counter */ \
-   if (false == apu.rectangle[ch].holdnote) \
-      apu.rectangle[ch].vbl_length--; \
-\
-   /* envelope decay at a rate of (env_delay + 1) / 240 secs */ \
-   apu.rectangle[ch].env_phase -= 4; /* 240/60 */ \
-   while (apu.rectangle[ch].env_phase < 0) \
-   { \
-      apu.rectangle[ch].env_phase += apu.rectangle[ch].env_delay; \
-\
-      if (apu.rectangle[ch].holdnote) \
-         apu.rectangle[ch].env_vol = (apu.rectangle[ch].env_vol + 1) & 0x0F; \
-      else if (apu.rectangle[ch].env_vol < 0x0F) \
-         apu.rectangle[ch].env_vol++; \
-   } \
-\
-   /* TODO: find true relation of freq_limit to register values */ \
-   if (apu.rectangle[ch].freq < 8 || (false == apu.rectangle[ch].sweep_inc && apu.rectangle[ch].freq > apu.rectangle[ch].freq_limit)) \
-      return APU_RECTANGLE_OUTPUT(ch); \
-\
-   /* frequency sweeping at a rate of (sweep_delay + 1) / 120 secs */ \
-   if (apu.rectangle[ch].sweep_on && apu.rectangle[ch].sweep_shifts) \
-   { \
-      apu.rectangle[ch].sweep_phase -= 2; /* 120/60 */ \
-      while (apu.rectangle[ch].sweep_phase < 0) \
-      { \
-         apu.rectangle[ch].sweep_phase += apu.rectangle[ch].sweep_delay; \
-\
-         if (apu.rectangle[ch].sweep_inc) /* ramp up */ \
-         { \
-            if (0 == ch) \
-               apu.rectangle[ch].freq += ~(apu.rectangle[ch].freq >> apu.rectangle[ch].sweep_shifts); \
-            else \
-               apu.rectangle[ch].freq -= (apu.rectangle[ch].freq >> apu.rectangle[ch].sweep_shifts); \
-         } \
-         else /* ramp down */ \
-         { \
-            apu.rectangle[ch].freq += (apu.rectangle[ch].freq >> apu.rectangle[ch].sweep_shifts); \
-         } \
-      } \
-   } \
-\
-   apu.rectangle[ch].accum -= apu.cycle_rate; \
-   if (apu.rectangle[ch].accum >= 0) \
-      return APU_RECTANGLE_OUTPUT(ch); \
-\
-   while (apu.rectangle[ch].accum < 0) \
-   { \
-      apu.rectangle[ch].accum += (apu.rectangle[ch].freq + 1); \
-      apu.rectangle[ch].adder = (apu.rectangle[ch].adder + 1) & 0x0F; \
-   } \
-\
-   if (apu.rectangle[ch].fixed_envelope) \
-      output = apu.rectangle[ch].volume << 8; /* fixed volume */ \
-   else \
-      output = (apu.rectangle[ch].env_vol ^ 0x0F) << 8; \
-\
-   if (0 == apu.rectangle[ch].adder) \
-      apu.rectangle[ch].output_vol = output; \
-   else if (apu.rectangle[ch].adder == apu.rectangle[ch].duty_flip) \
-      apu.rectangle[ch].output_vol = -output; \
-\
-   return APU_RECTANGLE_OUTPUT(ch); \
+   if (chan->fixed_envelope)
+      output = chan->volume; /* fixed volume */
+   else
+      output = chan->env_vol ^ 0x0F;
+
+   /* volume and duty changes are heard straight away */
+   apu_level(apu.pulse_buf, &chan->output_vol, (chan->adder < chan->duty_flip) ? output : 0, offset);
+
+   /* jump from edge to edge, rather than through every step between */
+   period = APU_CYCLES(chan->freq + 1);
+   while (chan->accum < limit)
+   {
+      steps = ((chan->adder < chan->duty_flip) ? chan->duty_flip : 0x10) - chan->adder;
+      edge = chan->accum + (steps - 1) * period;
+      if (edge >= limit)
+      {
+         steps = (int) ((limit - chan->accum) / period);
+         if (chan->accum + steps * period < limit)
+            steps++;
+
+         chan->adder = (chan->adder + steps) & 0x0F;
+         chan->accum += steps * period;
+         break;
+      }
+
+      chan->adder = (chan->adder + steps) & 0x0F;
+      chan->accum = edge + period;
+      apu_level(apu.pulse_buf, &chan->output_vol, (chan->adder < chan->duty_flip) ? output : 0, offset + edge);
+   }
+
+   chan->accum -= limit;
 }
 
-#endif /* !APU_OVERSAMPLE */
+static void apu_rectangle(int ch, int from, int to)
+{
+   rectangle_t *chan = &apu.rectangle[ch];
+   bool audible;
+   int count;
 
-/* generate the functions */
-APU_MAKE_RECTANGLE(0)
-APU_MAKE_RECTANGLE(1)
+   while (from < to)
+   {
+      if (false == chan->enabled || 0 == chan->vbl_length)
+      {
+         apu_level(apu.pulse_buf, &chan->output_vol, 0, from * apu.sample_cycles);
+         return;
+      }
+
+      /* TODO: find true relation of freq_limit to register values */
+      audible = (chan->freq >= 8
+                 && (chan->sweep_inc || chan->freq <= chan->freq_limit));
+
+      /* run up to the sample that next clocks the length counter, the
+      ** envelope or the sweep; its timer runs after them
+      */
+      count = to - from;
+      if (false == chan->holdnote && chan->vbl_length < count)
+         count = chan->vbl_length;
+      if (chan->env_phase / 4 < count)
+         count = chan->env_phase / 4 + 1;
+      if (audible && chan->sweep_on && chan->sweep_shifts
+          && chan->sweep_phase / 2 < count)
+         count = chan->sweep_phase / 2 + 1;
+
+      if (audible)
+         apu_rectangle_run(chan, from * apu.sample_cycles, count - 1);
+      else
+         apu_level(apu.pulse_buf, &chan->output_vol, 0, from * apu.sample_cycles);
+      from += count - 1;
+
+      /* vbl length counter */
+      if (false == chan->holdnote)
+         chan->vbl_length -= count;
+
+      /* envelope decay at a rate of (env_delay + 1) / 240 secs */
+      chan->env_phase -= 4 * count; /* 240/60 */
+      while (chan->env_phase < 0)
+      {
+         chan->env_phase += chan->env_delay;
+
+         if (chan->holdnote)
+            chan->env_vol = (chan->env_vol + 1) & 0x0F;
+         else if (chan->env_vol < 0x0F)
+            chan->env_vol++;
+      }
+
+      if (audible)
+      {
+         /* frequency sweeping at a rate of (sweep_delay + 1) / 120 secs */
+         if (chan->sweep_on && chan->sweep_shifts)
+         {
+            chan->sweep_phase -= 2 * count; /* 120/60 */
+            while (chan->sweep_phase < 0)
+            {
+               chan->sweep_phase += chan->sweep_delay;
+
+               if (chan->sweep_inc) /* ramp up */
+               {
+                  if (0 == ch)
+                     chan->freq += ~(chan->freq >> chan->sweep_shifts);
+                  else
+                     chan->freq -= (chan->freq >> chan->sweep_shifts);
+               }
+               else /* ramp down */
+               {
+                  chan->freq += (chan->freq >> chan->sweep_shifts);
+               }
+            }
+         }
+
+         apu_rectangle_run(chan, from * apu.sample_cycles, 1);
+      }
+      from++;
+   }
+}
 
 
 /* TRIANGLE WAVE
@@ -350,42 +384,75 @@ APU_MAKE_RECTANGLE(1)
 ** reg2: low 8 bits of frequency
 ** reg3: 7-3=length counter, 2-0=high 3 bits of frequency
 */
-static int32 apu_triangle(void)
+static void apu_triangle_run(apu_time_t offset, int count)
 {
-   APU_VOLUME_DECAY(apu.triangle.output_vol);
+   apu_time_t limit = count * apu.sample_cycles;
+   int32 level;
 
-   if (false == apu.triangle.enabled || 0 == apu.triangle.vbl_length)
-      return APU_TRIANGLE_OUTPUT;
-
-   if (apu.triangle.counter_started)
+   while (apu.triangle.accum < limit)
    {
-      if (apu.triangle.linear_length > 0)
-         apu.triangle.linear_length--;
-      if (apu.triangle.vbl_length && false == apu.triangle.holdnote)
-         apu.triangle.vbl_length--;
-   }
-   else if (false == apu.triangle.holdnote && apu.triangle.write_latency)
-   {
-      if (--apu.triangle.write_latency == 0)
-         apu.triangle.counter_started = true;
+      /* up 0-15, then back down 15-0 */
+      apu.triangle.adder = (apu.triangle.adder + 1) & 0x1F;
+
+      if (apu.triangle.adder & 0x10)
+         level = 0x1F - apu.triangle.adder;
+      else
+         level = apu.triangle.adder;
+
+      apu_level(apu.tnd_buf, &apu.triangle.output_vol, level * 3, offset + apu.triangle.accum);
+      apu.triangle.accum += APU_CYCLES(apu.triangle.freq);
    }
 
-   if (0 == apu.triangle.linear_length || apu.triangle.freq < 4) /* inaudible */
-      return APU_TRIANGLE_OUTPUT;
+   apu.triangle.accum -= limit;
+}
+
+/* a silent triangle holds its level, so nothing is added until it runs */
+static void apu_triangle(int from, int to)
+{
+   int count, audible;
 
-   apu.triangle.accum -= apu.cycle_rate; \
-   while (apu.triangle.accum < 0)
+   while (from < to)
    {
-      apu.triangle.accum += apu.triangle.freq;
-      apu.triangle.adder = (apu.triangle.adder + 1) & 0x1F;
+      if (false == apu.triangle.enabled || 0 == apu.triangle.vbl_length)
+         return;
 
-      if (apu.triangle.adder & 0x10)
-         apu.triangle.output_vol -= (2 << 8);
+      count = to - from;
+      if (apu.triangle.counter_started)
+      {
+         if (false == apu.triangle.holdnote && apu.triangle.vbl_length < count)
+            count = apu.triangle.vbl_length;
+
+         if (apu.triangle.linear_length > 0)
+         {
+            if (apu.triangle.linear_length < count)
+               count = apu.triangle.linear_length;
+            apu.triangle.linear_length -= count;
+         }
+
+         if (false == apu.triangle.holdnote)
+            apu.triangle.vbl_length -= count;
+
+         /* the sample that clocks the linear counter out is silent */
+         audible = (apu.triangle.linear_length > 0) ? count : count - 1;
+      }
       else
-         apu.triangle.output_vol += (2 << 8);
-   }
+      {
+         /* a length write holds the linear counter for its first sample,
+         ** or for as long as holdnote stays set
+         */
+         if (false == apu.triangle.holdnote)
+         {
+            count = 1;
+            apu.triangle.counter_started = true;
+         }
 
-   return APU_TRIANGLE_OUTPUT;
+         audible = (apu.triangle.linear_length > 0) ? count : 0;
+      }
+
+      if (audible > 0 && apu.triangle.freq >= 4) /* else inaudible */
+         apu_triangle_run(from * apu.sample_cycles, audible);
+      from += count;
+   }
 }
 
 
@@ -395,123 +462,98 @@ static int32 apu_triangle(void)
 ** reg2: 7=small(93 byte) sample,3-0=freq lookup
 ** reg3: 7-4=vbl length counter
 */
-/* TODO: AAAAAAAAAAAAAAAAAAAAAAAA!  #ifdef MADNESS! */
-static int32 apu_noise(void)
+INLINE int apu_noise_bit(void)
 {
-   int32 outvol;
-
-#if defined(APU_OVERSAMPLE) && defined(REALTIME_NOISE)
-#else /* !(APU_OVERSAMPLE && REALTIME_NOISE) */
-   int32 noise_bit;
-#endif /* !(APU_OVERSAMPLE && REALTIME_NOISE) */
-#ifdef APU_OVERSAMPLE
-   int num_times;
-   int32 total;
-#endif /* APU_OVERSAMPLE */
-
-   APU_VOLUME_DECAY(apu.noise.output_vol);
-
-   if (false == apu.noise.enabled || 0 == apu.noise.vbl_length)
-      return APU_NOISE_OUTPUT;
+#ifdef REALTIME_NOISE
+   return shift_register15(apu.noise.xor_tap);
+#else /* !REALTIME_NOISE */
+   apu.noise.cur_pos++;
 
-   /* vbl length counter */
-   if (false == apu.noise.holdnote)
-      apu.noise.vbl_length--;
+   if (apu.noise.short_sample)
+   {
+      if (APU_NOISE_93 == apu.noise.cur_pos)
+         apu.noise.cur_pos = 0;
 
-   /* envelope decay at a rate of (env_delay + 1) / 240 secs */
-   apu.noise.env_phase -= 4; /* 240/60 */
-   while (apu.noise.env_phase < 0)
+      return noise_short_lut[apu.noise.cur_pos];
+   }
+   else
    {
-      apu.noise.env_phase += apu.noise.env_delay;
+      if (APU_NOISE_32K == apu.noise.cur_pos)
+         apu.noise.cur_pos = 0;
 
-      if (apu.noise.holdnote)
-         apu.noise.env_vol = (apu.noise.env_vol + 1) & 0x0F;
-      else if (apu.noise.env_vol < 0x0F)
-         apu.noise.env_vol++;
+      return noise_long_lut[apu.noise.cur_pos];
    }
+#endif /* !REALTIME_NOISE */
+}
+
+static void apu_noise_run(apu_time_t offset, int count)
+{
+   apu_time_t limit = count * apu.sample_cycles;
+   int32 outvol;
 
-   apu.noise.accum -= apu.cycle_rate;
-   if (apu.noise.accum >= 0)
-      return APU_NOISE_OUTPUT;
-   
-#ifdef APU_OVERSAMPLE
    if (apu.noise.fixed_envelope)
-      outvol = apu.noise.volume << 8; /* fixed volume */
+      outvol = apu.noise.volume; /* fixed volume */
    else
-      outvol = (apu.noise.env_vol ^ 0x0F) << 8;
+      outvol = apu.noise.env_vol ^ 0x0F;
+   outvol *= 2;
 
-   num_times = total = 0;
-#endif /* APU_OVERSAMPLE */
+   /* volume changes are heard straight away */
+   if (apu.noise.output_vol)
+      apu_level(apu.tnd_buf, &apu.noise.output_vol, outvol, offset);
 
-   while (apu.noise.accum < 0)
+   while (apu.noise.accum < limit)
    {
-      apu.noise.accum += apu.noise.freq;
-
-#ifdef REALTIME_NOISE
-
-#ifdef APU_OVERSAMPLE
-      if (shift_register15(apu.noise.xor_tap))
-         total += outvol;
-      else
-         total -= outvol;
+      apu_level(apu.tnd_buf, &apu.noise.output_vol, apu_noise_bit() ? outvol : 0,
+                offset + apu.noise.accum);
+      apu.noise.accum += APU_CYCLES(apu.noise.freq);
+   }
 
-      num_times++;
-#else /* !APU_OVERSAMPLE */
-      noise_bit = shift_register15(apu.noise.xor_tap);
-#endif /* !APU_OVERSAMPLE */
+   apu.noise.accum -= limit;
+}
 
-#else /* !REALTIME_NOISE */
-      apu.noise.cur_pos++;
+static void apu_noise(int from, int to)
+{
+   int count;
 
-      if (apu.noise.short_sample)
-      {
-         if (APU_NOISE_93 == apu.noise.cur_pos)
-            apu.noise.cur_pos = 0;
-      }
-      else
+   while (from < to)
+   {
+      if (false == apu.noise.enabled || 0 == apu.noise.vbl_length)
       {
-         if (APU_NOISE_32K == apu.noise.cur_pos)
-            apu.noise.cur_pos = 0;
+         apu_level(apu.tnd_buf, &apu.noise.output_vol, 0, from * apu.sample_cycles);
+         return;
       }
 
-#ifdef APU_OVERSAMPLE
-      if (apu.noise.short_sample)
-         noise_bit = noise_short_lut[apu.noise.cur_pos];
-      else
-         noise_bit = noise_long_lut[apu.noise.cur_pos];
+      /* run up to the sample that next clocks the length counter or
+      ** the envelope; its timer runs after them
+      */
+      count = to - from;
+      if (false == apu.noise.holdnote && apu.noise.vbl_length < count)
+         count = apu.noise.vbl_length;
+      if (apu.noise.env_phase / 4 < count)
+         count = apu.noise.env_phase / 4 + 1;
+
+      apu_noise_run(from * apu.sample_cycles, count - 1);
+      from += count - 1;
+
+      /* vbl length counter */
+      if (false == apu.noise.holdnote)
+         apu.noise.vbl_length -= count;
+
+      /* envelope decay at a rate of (env_delay + 1) / 240 secs */
+      apu.noise.env_phase -= 4 * count; /* 240/60 */
+      while (apu.noise.env_phase < 0)
+      {
+         apu.noise.env_phase += apu.noise.env_delay;
 
-      if (noise_bit)
-         total += outvol;
-      else
-         total -= outvol;
+         if (apu.noise.holdnote)
+            apu.noise.env_vol = (apu.noise.env_vol + 1) & 0x0F;
+         else if (apu.noise.env_vol < 0x0F)
+            apu.noise.env_vol++;
+      }
 
-      num_times++;
-#endif /* APU_OVERSAMPLE */
-#endif /* !REALTIME_NOISE */
+      apu_noise_run(from * apu.sample_cycles, 1);
+      from++;
    }
-
-#ifdef APU_OVERSAMPLE
-   apu.noise.output_vol = total / num_times;
-#else /* !APU_OVERSAMPLE */
-   if (apu.noise.fixed_envelope)
-      outvol = apu.noise.volume << 8; /* fixed volume */
-   else
-      outvol = (apu.noise.env_vol ^ 0x0F) << 8;
-
-#ifndef REALTIME_NOISE
-   if (apu.noise.short_sample)
-      noise_bit = noise_short_lut[apu.noise.cur_pos];
-   else
-      noise_bit = noise_long_lut[apu.noise.cur_pos];
-#endif /* !REALTIME_NOISE */
-
-   if (noise_bit)
-      apu.noise.output_vol = outvol;
-   else
-      apu.noise.output_vol = -outvol;
-#endif /* !APU_OVERSAMPLE */
-
-   return APU_NOISE_OUTPUT;
 }
 
 
@@ -529,86 +571,82 @@ INLINE void apu_dmcreload(void)
 ** reg2: 8 bits of 64-byte aligned address offset : $C000 + (value * 64)
 ** reg3: length, (value * 16) + 1
 */
-static int32 apu_dmc(void)
+static void apu_dmc(int from, int to)
 {
+   apu_time_t offset = from * apu.sample_cycles;
+   apu_time_t limit = (to - from) * apu.sample_cycles;
    int delta_bit;
 
-   APU_VOLUME_DECAY(apu.dmc.output_vol);
+   /* pick up $4011 writes */
+   apu_level(apu.tnd_buf, &apu.dmc.output_vol, apu.dmc.regs[1], offset);
 
    /* only process when channel is alive */
-   if (apu.dmc.dma_length)
+   if (0 == apu.dmc.dma_length)
+      return;
+
+   while (apu.dmc.accum < limit)
    {
-      apu.dmc.accum -= apu.cycle_rate;
-      
-      while (apu.dmc.accum < 0)
+      delta_bit = (apu.dmc.dma_length & 7) ^ 7;
+
+      if (7 == delta_bit)
       {
-         apu.dmc.accum += apu.dmc.freq;
-         
-         delta_bit = (apu.dmc.dma_length & 7) ^ 7;
-         
-         if (7 == delta_bit)
-         {
-            apu.dmc.cur_byte = nes6502_getbyte(apu.dmc.address);
-            
-            /* steal a cycle from CPU*/
-            nes6502_burn(1);
-
-            /* prevent wraparound */
-            if (0xFFFF == apu.dmc.address)
-               apu.dmc.address = 0x8000;
-            else
-               apu.dmc.address++;
-         }
+         apu.dmc.cur_byte = nes6502_getbyte(apu.dmc.address);
 
-         if (--apu.dmc.dma_length == 0)
-         {
-            /* if loop bit set, we're cool to retrigger sample */
-            if (apu.dmc.looping)
-            {
-               apu_dmcreload();
-            }
-            else
-            {
-               /* check to see if we should generate an irq */
-               if (apu.dmc.irq_gen)
-               {
-                  apu.dmc.irq_occurred = true;
-                  if (apu.irq_callback)
-                     apu.irq_callback();
-               }
+         /* steal a cycle from CPU*/
+         nes6502_burn(1);
 
-               /* bodge for timestamp queue */
-               apu.dmc.enabled = false;
-               break;
-            }
-         }
+         /* prevent wraparound */
+         if (0xFFFF == apu.dmc.address)
+            apu.dmc.address = 0x8000;
+         else
+            apu.dmc.address++;
+      }
 
-         /* positive delta */
-         if (apu.dmc.cur_byte & (1 << delta_bit))
+      if (--apu.dmc.dma_length == 0)
+      {
+         /* if loop bit set, we're cool to retrigger sample */
+         if (apu.dmc.looping)
          {
-            if (apu.dmc.regs[1] < 0x7D)
-            {
-               apu.dmc.regs[1] += 2;
-               apu.dmc.output_vol += (2 << 8);
-            }
+            apu_dmcreload();
          }
-         /* negative delta */
-         else            
+         else
          {
-            if (apu.dmc.regs[1] > 1)
+            /* check to see if we should generate an irq */
+            if (apu.dmc.irq_gen)
             {
-               apu.dmc.regs[1] -= 2;
-               apu.dmc.output_vol -= (2 << 8);
+               apu.dmc.irq_occurred = true;
+               if (apu.irq_callback)
+                  apu.irq_callback();
             }
+
+            apu.dmc.accum = 0;
+            return;
          }
       }
+
+      /* positive delta */
+      if (apu.dmc.cur_byte & (1 << delta_bit))
+      {
+         if (apu.dmc.regs[1] < 0x7D)
+            apu.dmc.regs[1] += 2;
+      }
+      /* negative delta */
+      else
+      {
+         if (apu.dmc.regs[1] > 1)
+            apu.dmc.regs[1] -= 2;
+      }
+
+      apu_level(apu.tnd_buf, &apu.dmc.output_vol, apu.dmc.regs[1], offset + apu.dmc.accum);
+      apu.dmc.accum += APU_CYCLES(apu.dmc.freq);
    }
 
-   return APU_DMC_OUTPUT;
+   apu.dmc.accum -= limit;
 }
 
 
-void apu_write(uint32 address, uint8 value)
+/* apply a register write to the channels */
+static void apu_regwrite(uint32 address, uint8 value)
 {  
    int chan;
 
@@ -672,19 +710,6 @@ void apu_write(uint32 address, uint8 value)
    case APU_WRC3:
 
       apu.triangle.regs[2] = value;
-  
-      /* this is somewhat of a hack.  there appears to be some latency on 
-      ** the Real Thing between when trireg0 is written to and when the 
-      ** linear length counter actually begins its countdown.  we want to 
-      ** prevent the case where the program writes to the freq regs first, 
-      ** then to reg 0, and the counter accidentally starts running because 
-      ** of the sound queue's timestamp processing.
-      **
-      ** set latency to a couple hundred cycles -- should be plenty of time 
-      ** for the 6502 code to do a couple of table dereferences and load up 
-      ** the other triregs
-      */
-      apu.triangle.write_latency = (int) (228 / apu.cycle_rate);
       apu.triangle.freq = (((value & 7) << 8) + apu.triangle.regs[1]) + 1;
       apu.triangle.vbl_length = vbl_lut[value >> 3];
       apu.triangle.counter_started = false;
@@ -742,12 +767,8 @@ void apu_write(uint32 address, uint8 value)
       break;
 
    case APU_WRE1: /* 7-bit DAC */
-      /* add the _delta_ between written value and
-      ** current output level of the volume reg
-      */
-      value &= 0x7F; /* bit 7 ignored */
-      apu.dmc.output_vol += ((value - apu.dmc.regs[1]) << 8);
-      apu.dmc.regs[1] = value;
+      /* apu_dmc posts the step to the new level */
+      apu.dmc.regs[1] = value & 0x7F; /* bit 7 ignored */
       break;
 
    case APU_WRE2:
@@ -761,10 +782,6 @@ void apu_write(uint32 address, uint8 value)
       break;
 
    case APU_SMASK:
-      /* bodge for timestamp queue */
-      apu.dmc.enabled = (value & 0x10) ? true : false;
-      apu.enable_reg = value;
-
       for (chan = 0; chan < 2; chan++)
       {
          if (value & (1 << chan))
@@ -788,7 +805,6 @@ void apu_write(uint32 address, uint8 value)
          apu.triangle.vbl_length = 0;
          apu.triangle.linear_length = 0;
          apu.triangle.counter_started = false;
-         apu.triangle.write_latency = 0;
       }
 
       if (value & 0x08)
@@ -824,6 +840,86 @@ void apu_write(uint32 address, uint8 value)
    }
 }
 
+/* $4015 from the channels, once the queue has been replayed */
+static void apu_getstatus(void)
+{
+   apu.status = 0;
+
+   /* Return 1 in 0-5 bit pos if a channel is playing */
+   if (apu.rectangle[0].enabled && apu.rectangle[0].vbl_length)
+      apu.status |= 0x01;
+   if (apu.rectangle[1].enabled && apu.rectangle[1].vbl_length)
+      apu.status |= 0x02;
+   if (apu.triangle.enabled && apu.triangle.vbl_length)
+      apu.status |= 0x04;
+   if (apu.noise.enabled && apu.noise.vbl_length)
+      apu.status |= 0x08;
+   if (apu.dmc.dma_length)
+      apu.status |= 0x10;
+
+   if (apu.dmc.irq_occurred)
+      apu.status |= 0x80;
+}
+
+/* replay every queued write now */
+static void apu_flushqueue(void)
+{
+   while (apu.q_tail != apu.q_head)
+   {
+      apu_regwrite(apu.queue[apu.q_tail].address, apu.queue[apu.q_tail].value);
+      apu.q_tail = (apu.q_tail + 1) & APUQUEUE_MASK;
+   }
+}
+
+/* CPU writes are queued with the cycle they happened on, and replayed at
+** the matching sample when apu_process synthesizes the frame's audio
+*/
+void apu_write(uint32 address, uint8 value)
+{
+   apudata_t *d;
+
+   if (address > APU_SMASK)
+      return;
+
+   /* keep $4015 reads up with the write */
+   switch (address)
+   {
+   case APU_WRA3:
+   case APU_WRB3:
+   case APU_WRC3:
+   case APU_WRD3:
+      if (apu.enable_reg & (1 << ((address - APU_WRA3) >> 2)))
+         apu.status |= 1 << ((address - APU_WRA3) >> 2);
+      break;
+
+   case APU_WRE0:
+      if (0 == (value & 0x80))
+         apu.status &= ~0x80;
+      break;
+
+   case APU_SMASK:
+      apu.enable_reg = value;
+      apu.status = (apu.status & value & 0x0F) | (value & 0x10);
+      break;
+
+   default:
+      break;
+   }
+
+   /* when full, replay the oldest write early rather than lose it */
+   if (((apu.q_head + 1) & APUQUEUE_MASK) == apu.q_tail)
+   {
+      apu_regwrite(apu.queue[apu.q_tail].address, apu.queue[apu.q_tail].value);
+      apu.q_tail = (apu.q_tail + 1) & APUQUEUE_MASK;
+   }
+
+   d = &apu.queue[apu.q_head];
+   d->timestamp = nes6502_getcycles(false);
+   d->address = (uint16) address;
+   d->value = value;
+   apu.q_head = (apu.q_head + 1) & APUQUEUE_MASK;
+}
+
 /* Read from $4000-$4017 */
 uint8 apu_read(uint32 address)
 {
@@ -832,23 +928,7 @@ uint8 apu_read(uint32 address)
    switch (address)
    {
    case APU_SMASK:
-      value = 0;
-      /* Return 1 in 0-5 bit pos if a channel is playing */
-      if (apu.rectangle[0].enabled && apu.rectangle[0].vbl_length)
-         value |= 0x01;
-      if (apu.rectangle[1].enabled && apu.rectangle[1].vbl_length)
-         value |= 0x02;
-      if (apu.triangle.enabled && apu.triangle.vbl_length)
-         value |= 0x04;
-      if (apu.noise.enabled && apu.noise.vbl_length)
-         value |= 0x08;
-
-      /* bodge for timestamp queue */
-      if (apu.dmc.enabled)
-         value |= 0x10;
-
-      if (apu.dmc.irq_occurred)
-         value |= 0x80;
+      value = apu.status;
 
       if (apu.irqclear_callback)
          value |= apu.irqclear_callback();
@@ -872,12 +952,45 @@ uint8 apu_read(uint32 address)
       out = -0x8000; \
 }
 
-void apu_process(void *buffer, int num_samples)
+/* look up an integrated group level, interpolating between entries */
+INLINE int32 apu_mixlut(const int32 *lut, int32 sum, int max)
 {
-   static int32 prev_sample = 0;
+   int index = sum >> APU_BLEP_BITS;
+
+   if (sum <= 0)
+      return lut[0];
+   if (index >= max)
+      return lut[max];
+
+   return lut[index] + (((lut[index + 1] - lut[index])
+                         * (sum & ((1 << APU_BLEP_BITS) - 1))) >> APU_BLEP_BITS);
+}
+
+/* run the channels from sample from up to sample to of the block */
+static void apu_synth(int from, int to)
+{
+   if (apu.mix_enable & 0x01)
+      apu_rectangle(0, from, to);
+   if (apu.mix_enable & 0x02)
+      apu_rectangle(1, from, to);
+   if (apu.mix_enable & 0x04)
+      apu_triangle(from, to);
+   if (apu.mix_enable & 0x08)
+      apu_noise(from, to);
+   if (apu.mix_enable & 0x10)
+      apu_dmc(from, to);
+}
 
+void apu_process(void *buffer, int num_samples)
+{
    int16 *buf16;
    uint8 *buf8;
+   int count, done, from, to, i;
+   uint32 cycles, scale;
+
+   /* the cpu cycles since the last call are spread over these samples */
+   cycles = nes6502_getcycles(false) - apu.sync_cycles;
+   scale = cycles ? ((uint32) num_samples << 16) / cycles : 0;
 
    if (NULL != buffer)
    {
@@ -887,49 +1000,94 @@ void apu_process(void *buffer, int num_samples)
       buf16 = (int16 *) buffer;
       buf8 = (uint8 *) buffer;
 
-      while (num_samples--)
+      for (done = 0; done < num_samples; done += count)
       {
-         int32 next_sample, accum = 0;
-
-         if (apu.mix_enable & 0x01)
-            accum += apu_rectangle_0();
-         if (apu.mix_enable & 0x02)
-            accum += apu_rectangle_1();
-         if (apu.mix_enable & 0x04)
-            accum += apu_triangle();
-         if (apu.mix_enable & 0x08)
-            accum += apu_noise();
-         if (apu.mix_enable & 0x10)
-            accum += apu_dmc();
-         if (apu.ext && (apu.mix_enable & 0x20))
-            accum += apu.ext->process();
-
-         /* do any filtering */
-         if (APU_FILTER_NONE != apu.filter_type)
+         count = num_samples - done;
+         if (count > APU_BLOCK)
+            count = APU_BLOCK;
+
+         /* replay the writes at the sample they were made in */
+         for (from = 0; from < count; from = to)
          {
-            next_sample = accum;
+            to = count;
 
-            if (APU_FILTER_LOWPASS == apu.filter_type)
+            while (apu.q_tail != apu.q_head)
             {
-               accum += prev_sample;
-               accum >>= 1;
+               apudata_t *d = &apu.queue[apu.q_tail];
+               int pos = (int) (((int64_t) (int32) (d->timestamp - apu.sync_cycles) * scale) >> 16) - done;
+
+               if (pos > from)
+               {
+                  if (pos < to)
+                     to = pos;
+                  break;
+               }
+
+               apu_regwrite(d->address, d->value);
+               apu.q_tail = (apu.q_tail + 1) & APUQUEUE_MASK;
             }
-            else
-               accum = (accum + accum + accum + prev_sample) >> 2;
 
-            prev_sample = next_sample;
+            apu_synth(from, to);
          }
 
-         /* do clipping */
-         CLIP_OUTPUT16(accum);
+         for (i = 0; i < count; i++)
+         {
+            int32 next_sample, mix, accum;
+
+            /* integrate the steps and mix the two groups */
+            apu.pulse_sum += apu.pulse_buf[i];
+            apu.tnd_sum += apu.tnd_buf[i];
+            mix = apu_mixlut(pulse_lut, apu.pulse_sum, 30)
+                  + apu_mixlut(tnd_lut, apu.tnd_sum, 202);
+
+            /* block dc, decaying towards silence */
+            apu.dc_level += (mix - apu.prev_mix) << 8;
+            apu.prev_mix = mix;
+            APU_VOLUME_DECAY(apu.dc_level);
+            accum = apu.dc_level >> 8;
+
+            /* the mixer stays in range; expansion sound on top may not */
+            if (apu.ext && (apu.mix_enable & 0x20))
+            {
+               accum += apu.ext->process();
+               CLIP_OUTPUT16(accum);
+            }
 
-         /* signed 16-bit output, unsigned 8-bit */
-         if (16 == apu.sample_bits)
-            *buf16++ = (int16) accum;
-         else
-            *buf8++ = (accum >> 8) ^ 0x80;
+            /* do any filtering */
+            if (APU_FILTER_NONE != apu.filter_type)
+            {
+               next_sample = accum;
+
+               if (APU_FILTER_LOWPASS == apu.filter_type)
+               {
+                  accum += apu.prev_sample;
+                  accum >>= 1;
+               }
+               else
+                  accum = (accum + accum + accum + apu.prev_sample) >> 2;
+
+               apu.prev_sample = next_sample;
+            }
+
+            /* signed 16-bit output, unsigned 8-bit or unsigned 6-bit */
+            if (16 == apu.sample_bits)
+               *buf16++ = (int16) accum;
+            else if (6 == apu.sample_bits)
+               *buf8++ = (accum >> 10) + 0x20;
+            else
+               *buf8++ = (accum >> 8) ^ 0x80;
+         }
+
+         memmove(apu.pulse_buf, apu.pulse_buf + count, APU_BLEP_TAPS * sizeof(int32));
+         memset(apu.pulse_buf + APU_BLEP_TAPS, 0, count * sizeof(int32));
+         memmove(apu.tnd_buf, apu.tnd_buf + count, APU_BLEP_TAPS * sizeof(int32));
+         memset(apu.tnd_buf + APU_BLEP_TAPS, 0, count * sizeof(int32));
       }
    }
+
+   apu_flushqueue();
+   apu_getstatus();
+   apu.sync_cycles += cycles;
 }
 
 /* set the filter type */
@@ -943,10 +1101,21 @@ void apu_reset(void)
    uint32 address;
 
    /* initialize all channel members */
+   apu.q_head = apu.q_tail = 0;
    for (address = 0x4000; address <= 0x4013; address++)
-      apu_write(address, 0);
+      apu_regwrite(address, 0);
+
+   apu_regwrite(0x4015, 0);
+   apu.enable_reg = 0;
+   apu_getstatus();
+   apu.sync_cycles = nes6502_getcycles(false);
 
-   apu_write(0x4015, 0);
+   /* drop pending steps and the filters' memory, from a silent start */
+   memset(apu.pulse_buf, 0, 2 * APU_BLEP_BUFSIZE * sizeof(int32));
+   apu.pulse_sum = apu.tnd_sum = 0;
+   apu.prev_mix = apu.dc_level = apu.prev_sample = 0;
+   apu.rectangle[0].output_vol = apu.rectangle[1].output_vol = 0;
+   apu.triangle.output_vol = apu.noise.output_vol = apu.dmc.output_vol = 0;
 
    if (apu.ext && NULL != apu.ext->reset)
       apu.ext->reset();
@@ -954,6 +1123,7 @@ void apu_reset(void)
 
 void apu_build_luts(int num_samples)
 {
+   double scale;
    int i;
 
    /* lut used for enveloping and frequency sweeps */
@@ -968,6 +1138,17 @@ void apu_build_luts(int num_samples)
    for (i = 0; i < 128; i++)
       trilength_lut[i] = (int) (0.25 * i * num_samples);
 
+   /* nonlinear mixer, 95.52 / (8128 / n + 100) for the pulses and
+   ** 163.67 / (24329 / n + 100) for the rest, scaled so that both at
+   ** full tilt just reach 0x7FFF; one entry past the top interpolates
+   */
+   scale = 0x7FFF / (95.52 / (8128.0 / 30 + 100) + 163.67 / (24329.0 / 202 + 100));
+   pulse_lut[0] = tnd_lut[0] = 0;
+   for (i = 1; i < 32; i++)
+      pulse_lut[i] = (int32) (scale * 95.52 / (8128.0 / i + 100) + 0.5);
+   for (i = 1; i < 204; i++)
+      tnd_lut[i] = (int32) (scale * 163.67 / (24329.0 / i + 100) + 0.5);
+
 #ifndef REALTIME_NOISE
    /* generate noise samples */
    shift_register15(noise_long_lut, APU_NOISE_32K);
@@ -986,6 +1167,13 @@ void apu_setparams(double base_freq, int sample_rate, int refresh_rate, int samp
    else
       apu.base_freq = base_freq;
    apu.cycle_rate = (float) (apu.base_freq / sample_rate);
+#if APU_FIXED
+   apu.sample_cycles = (apu_time_t) (apu.base_freq * (1 << APU_FRAC_BITS) / sample_rate + 0.5);
+   apu.blep_scale = (uint32) (((uint64_t) APU_BLEP_PHASES << 32) / apu.sample_cycles);
+#else /* !APU_FIXED */
+   apu.sample_cycles = apu.cycle_rate;
+   apu.blep_scale = APU_BLEP_PHASES / apu.cycle_rate;
+#endif /* !APU_FIXED */
 
    /* build various lookup tables for apu */
    apu_build_luts(apu.num_samples);
@@ -1005,6 +1193,17 @@ apu_t *apu_create(double base_freq, int sample_rate, int refresh_rate, int sampl
 
    memset(temp_apu, 0, sizeof(apu_t));
 
+   /* both delta buffers in one block, apart from apu_t so that the
+   ** copies apu_getcontext makes on the stack stay small
+   */
+   temp_apu->pulse_buf = calloc(2 * APU_BLEP_BUFSIZE, sizeof(int32));
+   if (NULL == temp_apu->pulse_buf)
+   {
+      free(temp_apu);
+      return NULL;
+   }
+   temp_apu->tnd_buf = temp_apu->pulse_buf + APU_BLEP_BUFSIZE;
+
    /* set the update routine */
    temp_apu->process = apu_process;
    temp_apu->ext = NULL;
@@ -1033,6 +1232,7 @@ void apu_destroy(apu_t **src_apu)
    {
       if ((*src_apu)->ext && NULL != (*src_apu)->ext->shutdown)
          (*src_apu)->ext->shutdown();
+      free((*src_apu)->pulse_buf);
       free(*src_apu);
       *src_apu = NULL;
    }
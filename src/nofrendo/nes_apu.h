@@ -30,6 +30,20 @@
 /* define this for realtime generated noise */
 #define  REALTIME_NOISE
 
+/* channel timers in fixed point, which also makes the output the same
+** on every host; define as 0 for float timers
+*/
+#ifndef APU_FIXED
+#define  APU_FIXED      1
+#endif
+
+#if APU_FIXED
+#define  APU_FRAC_BITS  12
+typedef int32 apu_time_t;  /* cpu cycles, APU_FRAC_BITS of them fraction */
+#else /* !APU_FIXED */
+typedef float apu_time_t;  /* cpu cycles */
+#endif /* !APU_FIXED */
+
 #define  APU_WRA0       0x4000
 #define  APU_WRA1       0x4001
 #define  APU_WRA2       0x4002
@@ -69,7 +83,7 @@ typedef struct rectangle_s
 
    bool enabled;
    
-   float accum;
+   apu_time_t accum;
    int32 freq;
    int32 output_vol;
    bool fixed_envelope;
@@ -100,7 +114,7 @@ typedef struct triangle_s
 
    bool enabled;
 
-   float accum;
+   apu_time_t accum;
    int32 freq;
    int32 output_vol;
 
@@ -108,8 +122,6 @@ typedef struct triangle_s
 
    bool holdnote;
    bool counter_started;
-   /* quasi-hack */
-   int write_latency;
 
    int vbl_length;
    int linear_length;
@@ -122,7 +134,7 @@ typedef struct noise_s
 
    bool enabled;
 
-   float accum;
+   apu_time_t accum;
    int32 freq;
    int32 output_vol;
 
@@ -148,10 +160,7 @@ typedef struct dmc_s
 {
    uint8 regs[4];
 
-   /* bodge for timestamp queue */
-   bool enabled;
-   
-   float accum;
+   apu_time_t accum;
    int32 freq;
    int32 output_vol;
 
@@ -167,6 +176,17 @@ typedef struct dmc_s
 
 } dmc_t;
 
+/* register writes, queued until the frame's audio is synthesized */
+#define  APUQUEUE_SIZE  256
+#define  APUQUEUE_MASK  (APUQUEUE_SIZE - 1)
+
+typedef struct apudata_s
+{
+   uint32 timestamp;    /* cpu cycle of the write */
+   uint16 address;
+   uint8 value;
+} apudata_t;
+
 enum
 {
    APU_FILTER_NONE,
@@ -205,6 +225,19 @@ typedef struct apu_s
    noise_t noise;
    dmc_t dmc;
    uint8 enable_reg;
+   uint8 status; /* $4015 as the cpu reads it, queued writes included */
+
+   apudata_t queue[APUQUEUE_SIZE];
+   int q_head, q_tail;
+   uint32 sync_cycles; /* cpu cycle the next synthesized sample starts at */
+
+   /* pending steps, carrying the tails of the last block's into the next */
+   int32 *pulse_buf, *tnd_buf;
+   int32 pulse_sum, tnd_sum;
+
+   /* output filters: the mixer's dc blocker and the lowpass history */
+   int32 prev_mix, dc_level;
+   int32 prev_sample;
 
    void *buffer; /* pointer to output buffer */
    int num_samples;
@@ -214,6 +247,12 @@ typedef struct apu_s
 
    double base_freq;
    float cycle_rate;
+   apu_time_t sample_cycles; /* cycle_rate for the channel timers */
+#if APU_FIXED
+   uint32 blep_scale; /* delta buffer positions per timer unit, << 32 */
+#else /* !APU_FIXED */
+   float blep_scale; /* delta buffer positions per cpu cycle */
+#endif /* !APU_FIXED */
 
    int sample_rate;
    int sample_bits;
@@ -51,7 +51,7 @@
 #define  MMC_LAST2KVROM    (MMC_2KVROM - 1)
 #define  MMC_LAST1KVROM    (MMC_1KVROM - 1)
 
-static mmc_t mmc;
+static NES_LOCAL mmc_t mmc;
 
 rominfo_t *mmc_getinfo(void)
 {
@@ -102,6 +102,15 @@ void mmc_bankvrom(int size, uint32 address, int bank)
    }
 }
 
+/* push the machine's ROM page pointers into the running CPU core */
+static void mmc_syncrom(nes6502_context *cpu)
+{
+   int page;
+
+   for (page = 0x8000 >> NES6502_BANKSHIFT; page < NES6502_NUMBANKS; page++)
+      nes6502_setpage(page, cpu->mem_page[page]);
+}
+
 /* ROM bankswitching */
 void mmc_bankrom(int size, uint32 address, int bank)
 {
@@ -148,8 +157,10 @@ void mmc_bankrom(int size, uint32 address, int bank)
 
    default:
       log_printf("invalid ROM bank size %d\n", size);
-      break;
+      return;
    }
+
+   mmc_syncrom(cpu);
 }
 
 /* Check to see if this mapper is supported */
@@ -226,6 +237,7 @@ void mmc_reset(void)
 
    ppu_setlatchfunc(NULL);
    ppu_setvromswitch(NULL);
+   ppu_set_mapper_hook(NULL);
 
    if (mmc.intf->init)
       mmc.intf->init();
@@ -262,8 +274,6 @@ int mmc_setcart(struct nes_s *nes)
    nes->mmc = mmc_create(nes->rominfo);
    if (!nes->mmc) return -1;
    
-   wram_init(nes);
-   
    return 0;
 }
 
@@ -3,6 +3,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 #if defined(TRACE_MMC3) && TRACE_MMC3
 #include <stdio.h>
 #endif
@@ -37,15 +38,38 @@ extern int _active_lines;
 #endif
 
 /* ─────────────────── Build-time configuration ─────────────────── */
+/* Decoded CHR tile cache size in tiles (power of two); each entry is
+ * 32 bytes of packed rows plus its tag */
+#ifndef PPU_CHR_CACHE_TILES
+#define PPU_CHR_CACHE_TILES 256
+#endif
+
+/* PPU_PAL_SNAPS (colour snapshots per frame) is in new_ppu.h: the
+ * frontend sizes its colour tables from it */
+
+/* Dot loop variants, picked per cart by ppu_select_variant() so the loop
+ * only carries the features the cart uses */
+#define PPU_VAR_A12    0x01    /* track A12 for a mapper IRQ hook (MMC3-class) */
+#define PPU_VAR_LATCH  0x02    /* call the MMC2/MMC4 pattern-fetch latch */
+#define PPU_VAR_PAL    0x04    /* PAL frame timing */
+
 /* MMC3_A12_LOW_REQ constant removed - now using PPU-cycle timer */
 
 /* ─────────────────── MMC3 A12 edge filter state ─────────────────── */
-static bool a12_prev = false;                 /* last latched A12 */
-static int  mmc3_a12_low_m2_count = 0;       /* M2 cycles seen while A12 is low */
-static bool mmc3_a12_level = false;          /* current A12 level */
+static NES_LOCAL bool a12_prev = false;                 /* last latched A12 */
+static NES_LOCAL int  mmc3_a12_low_m2_count = 0;       /* M2 cycles seen while A12 is low */
+static NES_LOCAL bool mmc3_a12_level = false;          /* current A12 level */
 
 /* Forward declaration for mapper hook */
-static void (*mapper_ppu_hook)(uint16_t) = NULL;
+static NES_LOCAL void (*mapper_ppu_hook)(uint16_t) = NULL;
+
+/* Raster event log, see below */
+#if defined(PPU_EVENT_LOG) && PPU_EVENT_LOG
+static void ev_record(uint16_t reg, uint8_t value);
+#define PPU_EVENT(reg, value) ev_record((reg), (value))
+#else
+#define PPU_EVENT(reg, value) ((void)0)
+#endif
 
 ALWAYS_INLINE bool a12(uint16_t addr) { return (addr & 0x1000) != 0; }
 
@@ -59,6 +83,7 @@ static void mmc3_track_a12(uint16_t addr)
         printf("MMC3 A12: rising edge, low_count=%d\n", mmc3_a12_low_m2_count);
 #endif
         if (mmc3_a12_low_m2_count >= 3 && mapper_ppu_hook != NULL) {
+            PPU_EVENT(PPU_EVENT_A12, 0);
             mapper_ppu_hook(addr & 0x1FFF);
 #if defined(TRACE_MMC3) && TRACE_MMC3
             printf("MMC3 A12: IRQ clocked (count=%d)\n", mmc3_a12_low_m2_count);
@@ -120,18 +145,6 @@ static void mmc3_track_a12(uint16_t addr)
 
 #define RENDERING_ENABLED ((ppu.mask & (MASK_SHOW_BG | MASK_SHOW_SPR)) != 0)
 
-/* Helper to advance the master dot & line counters */
-#define INC_DOT()                                 \
-    do {                                          \
-        ++ppu.dot;                                \
-        if (ppu.dot == PPU_DOTS_PER_SCANLINE) {   \
-            ppu.dot = 0;                          \
-            ++ppu.scanline;                       \
-            if (ppu.scanline == PPU_SCANLINES_PER_FRAME) \
-                ppu.scanline = 0;                 \
-        }                                         \
-    } while (0)
-
 #define IS_VISIBLE_LINE   (ppu.scanline < 240)
 #define IS_PRERENDER_LINE (ppu.scanline == (ppu_is_pal ? 311 : 261))
 
@@ -140,33 +153,37 @@ static void mmc3_track_a12(uint16_t addr)
 #define PPU_JOY0   0x4016     /* VS joypad strobe / CHR bank switch */
 
 /* 4 KiB internal / CIRAM nametable RAM (supports 4-screen mode) */
-static uint8_t ciram[0x1000];
+static NES_LOCAL uint8_t ciram[0x1000];
 
 /* Nametable mirroring state */
-static uint8_t nametable_mapping[4] = {0, 1, 2, 3}; /* Default: 4-screen mode */
+static NES_LOCAL uint8_t nametable_mapping[4] = {0, 1, 2, 3}; /* Default: 4-screen mode */
 
 /* 4-screen mode flag for external VRAM access */
-static bool ppu_four_screen_enabled = false;
+static NES_LOCAL bool ppu_four_screen_enabled = false;
 
 /* Mapper-supplied callback for CHR banking on A12 rising edge */
 
 /* Global sprite display toggle */
-static bool sprites_enabled = true;
+static NES_LOCAL bool sprites_enabled = true;
 
 /* Global flag to control whether the PPU should actually write pixels to the
  * framebuffer. When disabled the PPU still runs through all cycles so timing
  * and side effects (sprite-0 hits, scroll updates, etc.) remain intact. */
-static bool draw_enabled = true;
+static NES_LOCAL bool draw_enabled = true;
+
+/* Frontend pacing: told before each drawn visible line is rendered, and
+ * at the start of the post-render line once the last one is done */
+static NES_LOCAL void (*line_sync)(int scanline) = NULL;
 
 /* PAL timing option */
-static bool ppu_is_pal = false;
+static NES_LOCAL bool ppu_is_pal = false;
 
 /* MMC-2 / MMC-4 callbacks */
-static void (*ppu_latchfunc)(uint32_t base, uint8_t tile) = NULL;
-static void (*ppu_vromswitch)(uint8_t data)               = NULL;
+static NES_LOCAL void (*ppu_latchfunc)(uint32_t base, uint8_t tile) = NULL;
+static NES_LOCAL void (*ppu_vromswitch)(uint8_t data)               = NULL;
 
 /* ─────────────────── Bit-reverse LUT for fast H-flip ─────────────────── */
-static uint8_t bitrev[256];
+static NES_LOCAL uint8_t bitrev[256];
 static void init_bitrev(void)
 {
     for (int i = 0; i < 256; ++i) {
@@ -178,30 +195,142 @@ static void init_bitrev(void)
     }
 }
 
+/* ─────────────────── 2bpp packing LUT ─────────────────── */
+/* Spreads a pattern plane byte to every other bit: abcdefgh -> 0a0b0c0d0e0f0g0h,
+ * so (spread[lo] | spread[hi] << 1) holds eight 2-bit pixels MSB-first */
+static NES_LOCAL uint16_t chr_spread[256];
+static void init_spread(void)
+{
+    for (int i = 0; i < 256; ++i) {
+        uint16_t w = 0;
+        for (int b = 0; b < 8; ++b)
+            if (i & (1 << b)) w |= 1 << (b * 2);
+        chr_spread[i] = w;
+    }
+}
+
+/* Inverse of the spread for a 32-bit packed register (even bits only) */
+static uint16_t chr_compact(uint32_t w)
+{
+    uint16_t b = 0;
+    for (int i = 0; i < 16; ++i)
+        if (w & (1UL << (i * 2))) b |= 1 << i;
+    return b;
+}
+
+#define CHR_ROW_LO 0x5555   /* plane-0 bits of a packed row */
+#define CHR_ROW_HI 0xAAAA   /* plane-1 bits of a packed row */
+
+/* ─────────────────── Dot action table ─────────────────── */
+/*
+ * What each dot of a scanline does, per class of line, so ppu_clock()
+ * tests one bitmask instead of a chain of line/dot ranges.  Actions
+ * marked R only happen with rendering enabled.
+ */
+enum { LINE_VISIBLE, LINE_PRERENDER, LINE_VBLANK, LINE_IDLE, LINE_CLASSES };
+
+#define DOT_LINE_START  0x0001  /* dot 0: latch the line's sprite 0 */
+#define DOT_PIXEL       0x0002  /* visible dots 1-256 */
+#define DOT_BG_SHIFT    0x0004  /* R: 2-257, 321-336 */
+#define DOT_SPR_SHIFT   0x0008  /* R: visible 1-256 */
+#define DOT_BG_FETCH    0x0010  /* R: 1-256, 321-340 */
+#define DOT_INC_Y       0x0020  /* R: 256 */
+#define DOT_COPY_X      0x0040  /* R: 257 */
+#define DOT_COPY_Y      0x0080  /* R: pre-render 280-304 */
+#define DOT_EVAL_BEGIN  0x0100  /* 1 */
+#define DOT_EVAL        0x0200  /* 65-256, when evaluating dot by dot */
+#define DOT_EVAL_END    0x0400  /* 257 */
+#define DOT_SPR_FETCH   0x0800  /* R: 257-320 */
+#define DOT_SPR_BUILD   0x1000  /* 320 */
+#define DOT_SPR_XMIN    0x2000  /* 321 */
+#define DOT_FRAME       0x4000  /* VBlank set/clear, odd-frame skip */
+
+#define DOT_RENDER_ONLY (DOT_BG_SHIFT | DOT_SPR_SHIFT | DOT_BG_FETCH | DOT_INC_Y | \
+                         DOT_COPY_X | DOT_COPY_Y | DOT_SPR_FETCH)
+
+static NES_LOCAL uint16_t dot_actions[LINE_CLASSES][PPU_DOTS_PER_SCANLINE];
+/* Dots from here on with nothing to do (never counting dot 340, which
+ * ends the line), by rendering off/on */
+static NES_LOCAL uint8_t  dot_idle[2][LINE_CLASSES][PPU_DOTS_PER_SCANLINE];
+
+static void init_dot_actions(void)
+{
+    for (int c = 0; c < LINE_CLASSES; ++c) {
+        bool fetch = (c == LINE_VISIBLE || c == LINE_PRERENDER);
+        for (int d = 0; d < PPU_DOTS_PER_SCANLINE; ++d) {
+            uint16_t a = 0;
+            if (d == 0) a |= DOT_LINE_START;
+            if (c == LINE_VISIBLE && d >= 1 && d <= 256) a |= DOT_PIXEL | DOT_SPR_SHIFT;
+            if ((d >= 2 && d <= 257) || (d >= 321 && d <= 336)) a |= DOT_BG_SHIFT;
+            if (fetch) {
+                if ((d >= 1 && d <= 256) || (d >= 321 && d <= 340)) a |= DOT_BG_FETCH;
+                if (d == 256) a |= DOT_INC_Y;
+                if (d == 257) a |= DOT_COPY_X;
+                if (c == LINE_PRERENDER && d >= 280 && d <= 304) a |= DOT_COPY_Y;
+                if (d >= 257 && d <= 320) a |= DOT_SPR_FETCH;
+            }
+            if (d == 1) a |= DOT_EVAL_BEGIN;
+            if (d >= 65 && d <= 256) a |= DOT_EVAL;
+            if (d == 257) a |= DOT_EVAL_END;
+            if (d == 320) a |= DOT_SPR_BUILD;
+            if (d == 321) a |= DOT_SPR_XMIN;
+            if ((c == LINE_VBLANK && d == 1) ||
+                (c == LINE_PRERENDER && (d == 1 || d == 339))) a |= DOT_FRAME;
+            dot_actions[c][d] = a;
+        }
+
+        /* DOT_EVAL is idle unless evaluating dot by dot, which the caller
+         * rules out */
+        for (int r = 0; r < 2; ++r) {
+            uint16_t busy = ~DOT_EVAL & (r ? 0xFFFF : ~DOT_RENDER_ONLY);
+            int run = 0;
+            dot_idle[r][c][PPU_DOTS_PER_SCANLINE - 1] = 0;
+            for (int d = PPU_DOTS_PER_SCANLINE - 2; d >= 0; --d) {
+                run = (dot_actions[c][d] & busy) ? 0 : (run < 255 ? run + 1 : 255);
+                dot_idle[r][c][d] = run;
+            }
+        }
+    }
+}
+
+static uint8_t line_class_of(int scanline)
+{
+    if (scanline < PPU_VISIBLE_Y) return LINE_VISIBLE;
+    if (scanline == PPU_SCANLINES_PER_FRAME - 1) return LINE_PRERENDER;
+    if (scanline == 241) return LINE_VBLANK;
+    return LINE_IDLE;
+}
+
 /* ─────────────────── Data structures ─────────────────── */
 
 typedef struct {
-    /* Pattern shift registers (16-bit) */
-    uint16_t pt_lo, pt_hi;
+    /* Pattern shift register: 16 packed 2-bit pixels */
+    uint32_t pt;
 
     /* Attribute shift registers (16-bit) */
     uint16_t at_lo, at_hi;
 
     /* Latches */
-    uint8_t  next_nt, next_at, next_pt_lo, next_pt_hi;
+    uint8_t  next_nt, next_at;
+    uint16_t next_pt;   /* packed row, plane 0 latched at dot 5, plane 1 at dot 7 */
 } bg_t;
 
 typedef struct {
-    uint8_t x;          /* pixel counter */
-    uint8_t pt_lo;      /* pattern shift regs (8 bits each) */
-    uint8_t pt_hi;
-    uint8_t attr;       /* attribute byte */
-    bool    in_range;
+    uint8_t  x;         /* pixel counter */
+    uint16_t pt;        /* packed pattern row, H-flip already applied */
+    uint8_t  attr;      /* attribute byte */
+    bool     in_range;
 } spr_unit_t;
 
 #define SPR_UNIT_MAX 8
 
-static struct {
+/* Sprite line buffer entry */
+#define SPR_LINE_PX      0x03   /* 2-bit pixel, 0 = transparent */
+#define SPR_LINE_PAL     0x0C   /* palette row << 2 */
+#define SPR_LINE_BEHIND  0x10   /* OAMF_BEHIND */
+#define SPR_LINE_ZERO    0x20   /* pixel belongs to the sprite-0 slot */
+
+static NES_LOCAL struct {
     /* $2000-$2002 shadow */
     uint8_t ctrl, mask, status;
     uint8_t oam_addr;
@@ -215,6 +344,7 @@ static struct {
 
     /* timing */
     int dot, scanline;
+    uint8_t line_class;  /* LINE_* of scanline */
     bool odd_frame;
     bool frame_complete;
 
@@ -239,7 +369,18 @@ static struct {
     uint8_t    sprite_count;     /* sprites in range (0-8) */
     bool       sprite_zero_next; /* sprite 0 in next line secondary OAM */
     bool       sprite_zero_this; /* sprite 0 in current line secondary OAM */
-    uint8_t    next_sprite_xmin; /* optimisation: earliest sprite X left */
+    uint8_t    next_sprite_xmin; /* earliest sprite X of the fetched line */
+
+    /* Sprites of the next line composited at dot 320, indexed by how many
+     * sprite shifts the line has had so far */
+    uint8_t    spr_line[256];
+    uint8_t    spr_line_pos;     /* shifts done this line (wraps after 256) */
+    uint8_t    spr_line_count;   /* units composited into spr_line */
+    bool       spr_line_zero;    /* spr_line holds sprite-0 pixels */
+
+    /* No-draw mode: BG shifts owed, applied in one go before the shifters
+     * are next reloaded or looked at */
+    uint8_t    bg_shift_pending;
 
     /* NEW: track which secondary-OAM slot corresponds to OAM #0 */
     uint8_t    sprite0_slot_next; /* 0..7 valid, 0xFF = none */
@@ -255,12 +396,14 @@ static struct {
     uint8_t    eval_byte_index;  /* 0..3: which byte of the sprite we're on */
     uint8_t    eval_read_latch;  /* last byte read on odd cycle */
     bool       oam_write_during_eval; /* OAM write occurred during sprite eval */
+    int        eval_dot;         /* next dot of 65-256 not yet evaluated */
+    bool       eval_per_dot;     /* $2003/$2004 touched: evaluate dot by dot */
 
     /* Sprite fetch state */
     uint8_t  spr_fetch_slot;    // 0..7
     uint8_t  spr_fetch_phase;   // 0..7 within the 8-cycle sequence
     uint8_t  spr_tmp_y, spr_tmp_tile, spr_tmp_attr, spr_tmp_x;
-    uint8_t  spr_lo, spr_hi;    // temp hold of fetched pattern bytes for the current slot
+    uint16_t spr_pt;            // temp hold of the fetched packed row for the current slot
     uint16_t spr_fetch_addr;
 
     /* palette */
@@ -278,8 +421,8 @@ static inline uint8_t apply_grayscale(uint8_t idx)
 }
 
 /* Emphasis lookup table --------------------------------------------------- */
-static uint8_t emphasis_lut[8][64];
-static bool    emphasis_lut_init = false;
+static NES_LOCAL uint8_t emphasis_lut[8][64];
+static NES_LOCAL bool    emphasis_lut_init = false;
 
 static void init_emphasis_lut(void)
 {
@@ -331,6 +474,177 @@ static inline uint8_t apply_emphasis_idx(uint8_t idx, uint8_t mask)
     return emphasis_lut[emph][idx & 0x3F];
 }
 
+/* ─────────────────── Deferred colour snapshots ─────────────────── */
+/*
+ * Pixels leave the PPU as palette RAM indexes; the frontend turns them into
+ * colours from snapshots of palette RAM and the PPUMASK colour bits.  Each
+ * visible line records the snapshot current at its dot 0.  A change while
+ * the line is being drawn moves on to a fresh snapshot, and the pixels that
+ * follow carry its distance from the line's one in their top bits.  Two
+ * pools alternate: one fills while the other holds the last drawn frame.
+ * Past 7 changes in a line or PPU_PAL_SNAPS in a frame the current
+ * snapshot is updated in place instead.
+ */
+#define MASK_COLOUR_BITS 0xE1   /* emphasis + grayscale */
+
+typedef struct {
+    ppu_pal_snap_t snap[PPU_PAL_SNAPS];
+    uint8_t        line[PPU_VISIBLE_Y];
+    uint8_t        count;
+} pal_pool_t;
+
+static NES_LOCAL pal_pool_t pal_pool[2];
+static NES_LOCAL uint8_t    pal_fill;      /* pool being filled */
+static NES_LOCAL uint8_t    pal_cur;       /* its current snapshot */
+static NES_LOCAL bool       pal_cur_based; /* a line starts with pal_cur */
+static NES_LOCAL uint8_t    pal_gen;       /* generation << 5 for this line's pixels */
+
+static void pal_snap_store(void)
+{
+    ppu_pal_snap_t *s = &pal_pool[pal_fill].snap[pal_cur];
+    memcpy(s->palette, ppu.palette, 32);
+    s->mask = ppu.mask & MASK_COLOUR_BITS;
+}
+
+/* Palette RAM or the PPUMASK colour bits changed */
+static void pal_snap_changed(void)
+{
+    pal_pool_t *pool = &pal_pool[pal_fill];
+    /* dot is the next one to run: pixels 1..dot-1 already used pal_cur */
+    bool drawn = IS_VISIBLE_LINE && ppu.dot >= 2 && ppu.dot <= 257;
+
+    if ((pal_cur_based || drawn) && pool->count < PPU_PAL_SNAPS &&
+        (!drawn || pal_gen < (7 << PPU_PIX_GEN_SHIFT))) {
+        pal_cur = pool->count++;
+        pal_cur_based = false;
+        if (drawn) {
+            pal_gen += 1 << PPU_PIX_GEN_SHIFT;
+        } else if (IS_VISIBLE_LINE && ppu.dot == 1) {
+            /* line already based, nothing drawn yet: rebase it */
+            pool->line[ppu.scanline] = pal_cur;
+            pal_cur_based = true;
+        }
+    }
+    pal_snap_store();
+}
+
+ALWAYS_INLINE void pal_line_begin(void)
+{
+    pal_pool[pal_fill].line[ppu.scanline] = pal_cur;
+    pal_cur_based = true;
+    pal_gen = 0;
+}
+
+/* Frame done: publish it if it was drawn and restart the filling pool
+ * from the colours in effect */
+static void pal_frame_end(void)
+{
+    ppu_pal_snap_t cur = pal_pool[pal_fill].snap[pal_cur];
+
+    if (draw_enabled)
+        pal_fill ^= 1;
+    pal_pool[pal_fill].snap[0] = cur;
+    pal_pool[pal_fill].count = 1;
+    pal_cur = 0;
+    pal_cur_based = false;
+}
+
+static void pal_snap_reset(void)
+{
+    memset(pal_pool, 0, sizeof pal_pool);
+    pal_pool[0].count = pal_pool[1].count = 1;
+    pal_fill = pal_cur = pal_gen = 0;
+    pal_cur_based = false;
+    pal_snap_store();
+}
+
+/* ─────────────────── Raster event log ─────────────────── */
+#if defined(PPU_EVENT_LOG) && PPU_EVENT_LOG
+/*
+ * Opt-in timeline of what reaches the PPU while a frame runs: register
+ * writes, OAM DMA, CHR page switches and mapper A12 clocks, each stamped
+ * with the dot it landed on.  Writes land exactly there since the core
+ * catches the PPU up before any register access.  One half of the log
+ * fills while the other holds the last frame, swapped at the frame wrap.
+ */
+typedef struct {
+    ppu_event_t         ev[PPU_EVENT_LOG_SIZE];
+    ppu_event_summary_t sum;
+} ev_frame_t;
+
+static NES_LOCAL ev_frame_t ev_log[2];
+static NES_LOCAL uint8_t    ev_fill;
+static NES_LOCAL uint32_t   ev_frames;
+
+int ppu_event_kind(uint16_t reg)
+{
+    if (reg >= 0x2000 && reg <= 0x2007) return reg & 7;
+    if (reg == PPU_OAMDMA)              return 8;
+    return 9 + (reg == PPU_EVENT_A12);
+}
+
+static void ev_record(uint16_t reg, uint8_t value)
+{
+    ppu_event_summary_t *sum = &ev_log[ev_fill].sum;
+
+    if (sum->events < PPU_EVENT_LOG_SIZE) {
+        ppu_event_t *e = &ev_log[ev_fill].ev[sum->events];
+        e->scanline = ppu.scanline;
+        e->dot      = ppu.dot;
+        e->reg      = reg;
+        e->value    = value;
+    }
+    if (sum->events < UINT16_MAX) sum->events++;
+
+    if (RENDERING_ENABLED && IS_VISIBLE_LINE) {
+        sum->raster++;
+        if (ppu.dot >= 1 && ppu.dot <= 256) {
+            sum->midline++;
+            sum->midline_kind[ppu_event_kind(reg)]++;
+        }
+    }
+}
+
+static void ev_frame_end(void)
+{
+    ev_fill ^= 1;
+    memset(&ev_log[ev_fill].sum, 0, sizeof ev_log[ev_fill].sum);
+    ev_log[ev_fill].sum.frame = ++ev_frames;
+}
+
+const ppu_event_t *ppu_event_log(ppu_event_summary_t *summary)
+{
+    const ev_frame_t *f = &ev_log[ev_fill ^ 1];
+    *summary = f->sum;
+    return f->ev;
+}
+
+void ppu_event_dump(FILE *out, bool events)
+{
+    static const char *const kind_name[PPU_EVENT_KINDS] = {
+        "CTRL", "MASK", "STAT", "OAMADDR", "OAMDATA", "SCROLL", "ADDR", "DATA",
+        "DMA", "CHR", "A12"
+    };
+    const ev_frame_t *f = &ev_log[ev_fill ^ 1];
+    int kept = f->sum.events < PPU_EVENT_LOG_SIZE ? f->sum.events : PPU_EVENT_LOG_SIZE;
+
+    if (events) {
+        for (int i = 0; i < kept; ++i) {
+            const ppu_event_t *e = &f->ev[i];
+            fprintf(out, "ppu %3d:%3d %-7s %02X\n", e->scanline, e->dot,
+                    kind_name[ppu_event_kind(e->reg)], e->value);
+        }
+    }
+    fprintf(out, "ppu frame %u: %u events (%d kept), %u on rendered lines, %u mid-line",
+            (unsigned) f->sum.frame, f->sum.events, kept, f->sum.raster, f->sum.midline);
+    for (int k = 0; k < PPU_EVENT_KINDS; ++k) {
+        if (f->sum.midline_kind[k])
+            fprintf(out, " %s:%u", kind_name[k], f->sum.midline_kind[k]);
+    }
+    fprintf(out, "\n");
+}
+#endif
+
 ALWAYS_INLINE uint8_t *ciram_ptr(uint16_t addr)
 {
     /* Nametable addressing: $2000-$2FFF -> NT 0,1,2,3 */
@@ -362,24 +676,27 @@ ALWAYS_INLINE void pal_write_raw(uint16_t addr, uint8_t v)
     /* Hardware mirrors palette index 0 ($3F00/$3F04/$3F08/$3F0C)
        across *both* BG and sprite banks ($3F10 etc.). */
     uint8_t val = v & 0x3F;
+    if (ppu.palette[addr] == val)
+        return;
     if ((addr & 0x03) == 0) {
         ppu.palette[addr]        = val;
         ppu.palette[addr ^ 0x10] = val;
     } else {
         ppu.palette[addr] = val;
     }
+    pal_snap_changed();
 }
 
 
 /* ─────────────────── CHR bus accessors ─────────────────── */
 /* Legacy memory mapping compatibility - translates to MMC interface calls */
-static uint8_t *chr_page_ptrs[16]; /* Track page pointers for 16 1 KiB pages */
-static uint8_t *chrram_ptr = NULL; /* Base pointer to CHR RAM */
-static size_t   chrram_size = 0;   /* Size of CHR RAM in bytes */
+static NES_LOCAL uint8_t *chr_page_ptrs[16]; /* Track page pointers for 16 1 KiB pages */
+static NES_LOCAL uint8_t *chrram_ptr = NULL; /* Base pointer to CHR RAM */
+static NES_LOCAL size_t   chrram_size = 0;   /* Size of CHR RAM in bytes */
 
 /* Cached pointer to NES context to avoid global lookups */
 static nes_t *ppu_get_nes(void) {
-    static nes_t *nes = NULL;
+    static NES_LOCAL nes_t *nes = NULL;
     if (!nes) nes = nes_getcontextptr();
     return nes;
 }
@@ -406,6 +723,73 @@ ALWAYS_INLINE uint8_t chr_read(uint16_t addr)
     return 0;
 }
 
+/* ─────────────────── Decoded CHR tile cache ─────────────────── */
+/*
+ * For CHR-ROM the page table points into memory-mapped flash, so pattern
+ * fetches decode whole tiles once into a direct-mapped RAM cache keyed by
+ * the tile's source address.  Each row is kept packed (see chr_spread)
+ * and pre-flipped for sprites.  Entries are dropped on CHR-RAM writes,
+ * when a page is unmapped, and wholesale on reset or state load.
+ */
+typedef struct {
+    const uint8_t *src;          /* tile bytes this entry was decoded from */
+    uint16_t row[8];
+    uint16_t row_hflip[8];
+} chr_tile_t;
+
+static NES_LOCAL chr_tile_t chr_cache[PPU_CHR_CACHE_TILES];
+static NES_LOCAL uint32_t   chr_cache_hits, chr_cache_misses;
+
+ALWAYS_INLINE chr_tile_t *chr_cache_slot(const uint8_t *src)
+{
+    return &chr_cache[((uintptr_t)src >> 4) & (PPU_CHR_CACHE_TILES - 1)];
+}
+
+/* Start of the 16-byte tile holding a pattern address, resolved as chr_read() does */
+ALWAYS_INLINE const uint8_t *chr_tile_src(uint16_t addr)
+{
+    const uint8_t *page = chr_page_ptrs[(addr >> 10) & 0x0F];
+    if (page) return page + (addr & 0x3F0);
+    if (chrram_ptr && chrram_size) return chrram_ptr + ((addr % chrram_size) & ~0x0F);
+    return NULL;
+}
+
+static void chr_cache_fill(chr_tile_t *t, const uint8_t *src)
+{
+    for (int r = 0; r < 8; ++r) {
+        uint8_t lo = src[r], hi = src[r + 8];
+        t->row[r]       = chr_spread[lo] | (chr_spread[hi] << 1);
+        t->row_hflip[r] = chr_spread[bitrev[lo]] | (chr_spread[bitrev[hi]] << 1);
+    }
+    t->src = src;
+}
+
+static void chr_cache_drop(const uint8_t *src)
+{
+    chr_tile_t *t = chr_cache_slot(src);
+    if (t->src == src) t->src = NULL;
+}
+
+/* Pattern fetch returning the packed row for addr; the caller keeps the
+ * plane it asked for (addr & 8).  A12 is tracked as chr_read() does in the
+ * variants that need it */
+ALWAYS_INLINE uint16_t chr_fetch_row(uint16_t addr, bool hflip, const int var)
+{
+    if (var & PPU_VAR_A12) mmc3_track_a12(addr);
+
+    const uint8_t *src = chr_tile_src(addr);
+    if (!src) return 0;
+
+    chr_tile_t *t = chr_cache_slot(src);
+    if (t->src == src) {
+        ++chr_cache_hits;
+    } else {
+        ++chr_cache_misses;
+        chr_cache_fill(t, src);
+    }
+    return hflip ? t->row_hflip[addr & 7] : t->row[addr & 7];
+}
+
 ALWAYS_INLINE uint8_t ppu_bus_read(uint16_t addr)
 {
     addr &= 0x3FFF;
@@ -421,6 +805,7 @@ ALWAYS_INLINE void ppu_bus_write(uint16_t addr, uint8_t v)
         /* CHR-RAM write */
         if (chrram_ptr && chrram_size) {
             chrram_ptr[addr % chrram_size] = v;
+            chr_cache_drop(chrram_ptr + ((addr % chrram_size) & ~0x0F));
         }
         mmc3_track_a12(addr);        /* track A12 edges on writes too */
     } else if (addr < 0x3F00) {
@@ -464,16 +849,40 @@ ALWAYS_INLINE void copy_y_from_t(void) { ppu.v = (ppu.v & ~0x7BE0) | (ppu.t & 0x
 /* ─────────────────── Background pipeline ─────────────────── */
 ALWAYS_INLINE void bg_shift(void)
 {
-    ppu.bg.pt_lo <<= 1;
-    ppu.bg.pt_hi <<= 1;
+    ppu.bg.pt <<= 2;
     ppu.bg.at_lo <<= 1;
     ppu.bg.at_hi <<= 1;
 }
+/* Apply the shifts owed by the no-draw path */
+ALWAYS_INLINE void bg_shift_flush(void)
+{
+    uint8_t n = ppu.bg_shift_pending;
+    if (!n) return;
+    ppu.bg_shift_pending = 0;
+    if (n >= 16) {
+        ppu.bg.pt = 0;
+        ppu.bg.at_lo = ppu.bg.at_hi = 0;
+    } else {
+        ppu.bg.pt <<= 2 * n;
+        ppu.bg.at_lo <<= n;
+        ppu.bg.at_hi <<= n;
+    }
+}
+
+/* Per-dot shift; with nothing drawn only sprite-0 looks at the shifters,
+ * so the shift is deferred */
+ALWAYS_INLINE void bg_shift_dot(void)
+{
+    if (draw_enabled) bg_shift();
+    else              ++ppu.bg_shift_pending;
+}
+
 ALWAYS_INLINE void bg_reload_shifters(void)
 {
+    bg_shift_flush();
+
     /* pattern */
-    ppu.bg.pt_lo = (ppu.bg.pt_lo & 0x00FF) | ((uint16_t)ppu.bg.next_pt_lo << 8);
-    ppu.bg.pt_hi = (ppu.bg.pt_hi & 0x00FF) | ((uint16_t)ppu.bg.next_pt_hi << 8);
+    ppu.bg.pt = (ppu.bg.pt & 0x0000FFFF) | ((uint32_t)ppu.bg.next_pt << 16);
 
     /* attribute – replicate palette bits across 16-bit regs */
     uint8_t attr = ppu.bg.next_at;
@@ -483,7 +892,7 @@ ALWAYS_INLINE void bg_reload_shifters(void)
     ppu.bg.at_hi = (ppu.bg.at_hi & 0x00FF) | (hi & 0xFF00);
 }
 
-ALWAYS_INLINE void bg_fetch(void)
+ALWAYS_INLINE void bg_fetch(const int var)
 {
     int cyc = ppu.dot & 7;
 
@@ -506,9 +915,9 @@ ALWAYS_INLINE void bg_fetch(void)
         uint16_t addr = base + tile * 16 + ((ppu.v >> 12) & 7);
 
         /* MMC-2 / MMC-4 latch */
-        if (ppu_latchfunc) ppu_latchfunc(base, tile);
+        if (var & PPU_VAR_LATCH) ppu_latchfunc(base, tile);
 
-        ppu.bg.next_pt_lo = chr_read(addr);
+        ppu.bg.next_pt = (ppu.bg.next_pt & CHR_ROW_HI) | (chr_fetch_row(addr, false, var) & CHR_ROW_LO);
         break;
     }
     case 7: /* PT high + reload */
@@ -516,7 +925,7 @@ ALWAYS_INLINE void bg_fetch(void)
         uint16_t base = (ppu.ctrl & PPU_CTRL0F_BGADDR) ? 0x1000 : 0x0000;
         uint8_t tile = ppu.bg.next_nt;
         uint16_t addr = base + tile * 16 + ((ppu.v >> 12) & 7) + 8;
-        ppu.bg.next_pt_hi = chr_read(addr);
+        ppu.bg.next_pt = (ppu.bg.next_pt & CHR_ROW_LO) | (chr_fetch_row(addr, false, var) & CHR_ROW_HI);
         bg_reload_shifters();
         break;
     }
@@ -528,6 +937,22 @@ ALWAYS_INLINE void bg_fetch(void)
 }
 
 /* ─────────────────── Cycle-accurate sprite evaluation ─────────────────── */
+/* Initialize sprite evaluation state at start of each line */
+ALWAYS_INLINE void eval_sprite_begin(void)
+{
+    memset(ppu.sec_oam, 0xFF, 32);
+    ppu.eval_sprite_idx = 0;
+    ppu.eval_oam_addr = 0;
+    ppu.eval_sec_idx = 0;
+    ppu.eval_overflow = false;
+    ppu.sprite_zero_next = false;
+    ppu.sprite0_slot_next = 0xFF;
+    ppu.eval_byte_index = 0;
+    ppu.eval_read_latch = 0;
+    ppu.eval_dot = 65;
+    ppu.eval_per_dot = false;
+}
+
 static void eval_sprite_read_primary(void)
 {
     if (ppu.eval_oam_addr > 255) return; /* All sprites processed */
@@ -593,24 +1018,112 @@ static void eval_sprite_write_secondary(void)
     ppu.eval_byte_index = (ppu.eval_byte_index + 1) & 3;
 }
 
-/* Legacy sprite evaluation function removed - now using cycle-accurate evaluation */
+/*
+ * n odd/even read/write pairs in one go, leaving exactly the state n calls
+ * of each function above would.  An out-of-range sprite costs four pairs
+ * and an in-range one is copied whole; the full-secondary-OAM +5 walk and
+ * any sprite the budget would split go through the per-dot functions.
+ */
+static void eval_sprite_pairs(int n)
+{
+    const uint8_t spr_h = (ppu.ctrl & PPU_CTRL0F_SPR16) ? 16 : 8;
+    const int16_t cur_line = ppu.scanline + 1;
+
+    while (n > 0 && ppu.eval_oam_addr <= 255) {
+        if (ppu.eval_byte_index == 0 && ppu.eval_sec_idx < 32 && n >= 4 &&
+            !ppu.oam_write_during_eval) {
+            uint16_t a = ppu.eval_oam_addr;
+            int16_t diff = cur_line - (int16_t)ppu.oam[a];
+
+            ppu.sprite_in_range = (diff >= 0 && diff < spr_h);
+            ppu.eval_sprite_idx = a >> 2;
+            if (ppu.sprite_in_range) {
+                if (ppu.eval_sprite_idx == 0) {
+                    ppu.sprite_zero_next  = true;
+                    ppu.sprite0_slot_next = ppu.eval_sec_idx >> 2;
+                }
+                for (int k = 0; k < 4; ++k)
+                    ppu.sec_oam[ppu.eval_sec_idx++] = ppu.oam[(a + k) & 0xFF];
+            }
+            ppu.eval_read_latch = ppu.oam[(a + 3) & 0xFF];
+            ppu.eval_oam_addr = (a + 4) & 0xFF;
+            n -= 4;
+        } else {
+            eval_sprite_read_primary();
+            eval_sprite_write_secondary();
+            --n;
+        }
+    }
+}
+
+/*
+ * Evaluation is run lazily: dots from eval_dot up to (not including) upto
+ * are caught up here, in one pass when nothing touched the inputs during
+ * the window.  Anything that could change the result or observe it
+ * mid-window (PPUCTRL/PPUMASK, $2003/$2004, OAM DMA, state access) calls
+ * this first, so the pending dots always see the inputs they would have
+ * seen one at a time.
+ */
+static void eval_sync(int upto)
+{
+    int dot = (ppu.eval_dot < 65) ? 65 : ppu.eval_dot;
+    int end = (upto < 257) ? upto : 257;
 
-/* ─────────────────── Sprite fetch (now with MMC-2 latch support) ─────────────────── */
-ALWAYS_INLINE void sprite_shift(void)
+    if (dot >= end) return;
+    ppu.eval_dot = end;
+    if (!RENDERING_ENABLED || !(IS_VISIBLE_LINE || IS_PRERENDER_LINE)) return;
+
+    if (!(dot & 1)) { /* finish a pair a previous catch-up split */
+        eval_sprite_write_secondary();
+        ++dot;
+    }
+    int pairs = (end - dot) >> 1;
+    eval_sprite_pairs(pairs);
+    if (dot + pairs * 2 < end)
+        eval_sprite_read_primary();
+}
+
+/* ─────────────────── Sprite line buffer ─────────────────── */
+/*
+ * Once the last sprite fetch lands at dot 320 the eight units are fixed
+ * until the next line's dot 257, so their output is composited here in
+ * slot order (lowest opaque slot wins).  A unit at X shows column c of
+ * its row after X + c sprite shifts; indexing by shifts rather than by
+ * dot keeps the buffer right when rendering is paused mid-line.
+ */
+static void sprite_line_build(void)
 {
-    uint8_t min_x = 255;
+    uint8_t count = 0;
+    bool zero = false;
+
+    if (ppu.spr_line_count)
+        memset(ppu.spr_line, 0, sizeof ppu.spr_line);
+    ppu.spr_line_pos = 0;
+
     for (uint8_t i = 0; i < SPR_UNIT_MAX; ++i) {
         spr_unit_t *u = &ppu.spr[i];
         if (!u->in_range) continue;
-        if (u->x == 0) {
-            u->pt_lo <<= 1;
-            u->pt_hi <<= 1;
-        } else {
-            --u->x;
+
+        uint8_t tag = ((u->attr & OAMF_PALETTE) << 2) |
+                      ((u->attr & OAMF_BEHIND) ? SPR_LINE_BEHIND : 0) |
+                      ((i == ppu.sprite0_slot_next) ? SPR_LINE_ZERO : 0);
+        uint16_t row = u->pt;
+        for (int col = u->x; row && col < 256; ++col, row <<= 2) {
+            uint8_t px = row >> 14;
+            if (px && !(ppu.spr_line[col] & SPR_LINE_PX)) {
+                ppu.spr_line[col] = tag | px;
+                zero |= (tag & SPR_LINE_ZERO) != 0;
+            }
         }
-        if (u->x < min_x) min_x = u->x;
+        ++count;
     }
-    ppu.next_sprite_xmin = (min_x == 255) ? 0 : min_x;
+    ppu.spr_line_count = count;
+    ppu.spr_line_zero = zero;
+}
+
+ALWAYS_INLINE void sprite_shift(void)
+{
+    ++ppu.spr_line_pos;
 }
 
 /* ─────────────────── Pixel composition ─────────────────── */
@@ -621,13 +1134,29 @@ ALWAYS_INLINE uint8_t bg_pixel(uint8_t *pal_row_out)
     }
 
     uint16_t bit = 0x8000 >> ppu.x;
-    uint8_t p0 = (ppu.bg.pt_lo & bit) ? 1 : 0;
-    uint8_t p1 = (ppu.bg.pt_hi & bit) ? 1 : 0;
     uint8_t a0 = (ppu.bg.at_lo & bit) ? 1 : 0;
     uint8_t a1 = (ppu.bg.at_hi & bit) ? 1 : 0;
 
     *pal_row_out = (a1 << 1) | a0;
-    return (p1 << 1) | p0;
+    return (ppu.bg.pt >> (30 - 2 * ppu.x)) & 3;
+}
+
+/* Sprite-0 hit detection - occurs at exact cycle of collision */
+ALWAYS_INLINE void sprite0_hit(uint8_t e)
+{
+    if ((e & SPR_LINE_ZERO) && ppu.sprite_zero_this && (ppu.mask & MASK_SHOW_BG) &&
+        ((ppu.mask & MASK_LEFT_BG) || ppu.dot > 8)) {
+        bool would_hit = ((ppu.bg.pt >> (30 - 2 * ppu.x)) & 3) != 0;
+
+        if (would_hit && ppu.dot == 255) {
+#if defined(TRACE_PPU) && TRACE_PPU
+            printf("Sprite-0: suppressed hit at dot %d (scanline %d)\n",
+                   ppu.dot, ppu.scanline);
+#endif
+        } else if (would_hit) {
+            ppu.status |= PPU_STATF_STRIKE;
+        }
+    }
 }
 
 ALWAYS_INLINE uint8_t sprite_pixel(uint8_t *pal_row_out, uint8_t *prio_out)
@@ -636,44 +1165,45 @@ ALWAYS_INLINE uint8_t sprite_pixel(uint8_t *pal_row_out, uint8_t *prio_out)
         *pal_row_out = *prio_out = 0; return 0;
     }
 
-    /* Early-out optimisation: nothing can hit yet */
-    if (ppu.next_sprite_xmin > 0) {
-        --ppu.next_sprite_xmin; /* countdown to next sprite entrance */
+    uint8_t e = ppu.spr_line[ppu.spr_line_pos];
+    uint8_t px = e & SPR_LINE_PX;
+    if (!px) {
         *pal_row_out = *prio_out = 0;
         return 0;
     }
+    *pal_row_out = (e & SPR_LINE_PAL) >> 2;
+    *prio_out    = (e & SPR_LINE_BEHIND) != 0;
 
-    for (uint8_t i = 0; i < SPR_UNIT_MAX; ++i) {
-        spr_unit_t *u = &ppu.spr[i];
-        if (!u->in_range) continue;
-        if (u->x == 0) {
-            uint8_t p0 = (u->pt_lo & 0x80) ? 1 : 0;
-            uint8_t p1 = (u->pt_hi & 0x80) ? 1 : 0;
-            uint8_t px = (p1 << 1) | p0;
-            if (px) {
-                *pal_row_out = u->attr & 0x03;
-                *prio_out    = (u->attr & OAMF_BEHIND) != 0;
-
-                /* Sprite-0 hit detection - occurs at exact cycle of collision */
-                if (i == ppu.sprite0_slot_this && ppu.sprite_zero_this && (ppu.mask & MASK_SHOW_BG) &&
-                    ((ppu.mask & MASK_LEFT_BG) || ppu.dot > 8)) {
-                    uint16_t bit = 0x8000 >> ppu.x;
-                    bool would_hit = (ppu.bg.pt_lo & bit) || (ppu.bg.pt_hi & bit);
-                    
-                    if (would_hit && ppu.dot == 255) {
-#if defined(TRACE_PPU) && TRACE_PPU
-                        printf("Sprite-0: suppressed hit at dot %d (scanline %d)\n", 
-                               ppu.dot, ppu.scanline);
-#endif
-                    } else if (would_hit && ppu.dot != 255) {
-                        ppu.status |= PPU_STATF_STRIKE;
-                    }
-                }
-                return px;
-            }
-        }
+    sprite0_hit(e);
+    return px;
+}
+
+/* No-draw counterpart of sprite_pixel(): only the sprite-0 hit it would
+ * have caused.  Lines without sprite-0 pixels never get here. */
+ALWAYS_INLINE void sprite0_probe(void)
+{
+    if (!sprites_enabled || !(ppu.mask & MASK_SHOW_SPR) || (!(ppu.mask & MASK_LEFT_SPR) && ppu.dot <= 8))
+        return;
+
+    uint8_t e = ppu.spr_line[ppu.spr_line_pos];
+    if (e & SPR_LINE_ZERO) {
+        bg_shift_flush();
+        sprite0_hit(e);
     }
-    return 0;
+}
+
+/* Mux BG/sprite into a palette RAM index; colour is resolved at the blit */
+ALWAYS_INLINE uint8_t compose_pixel(uint8_t bg_px, uint8_t bg_pal_row,
+                                    uint8_t spr_px, uint8_t spr_pal_row, uint8_t spr_pri)
+{
+    uint8_t idx;
+    if (spr_px && (!bg_px || !spr_pri))
+        idx = 0x10 | (spr_pal_row << 2) | spr_px;
+    else if (bg_px)
+        idx = (bg_pal_row << 2) | bg_px;
+    else
+        idx = 0;
+    return pal_gen | idx;
 }
 
 /* ─────────────────── NMI helper ─────────────────── */
@@ -695,15 +1225,24 @@ ALWAYS_INLINE void nmi_step(void)
 }
 
 /* ─────────────────── Public API ─────────────────── */
-void ppu_set_mapper_hook(void (*fn)(uint16_t)) { mapper_ppu_hook = fn; }
-void ppu_setlatchfunc(ppulatchfunc_t fn)       { ppu_latchfunc   = fn; }
+static void ppu_select_variant(void);
+
+void ppu_set_mapper_hook(void (*fn)(uint16_t)) { mapper_ppu_hook = fn; ppu_select_variant(); }
+void ppu_setlatchfunc(ppulatchfunc_t fn)       { ppu_latchfunc   = fn; ppu_select_variant(); }
 void ppu_setvromswitch(ppuvromswitch_t fn)     { ppu_vromswitch  = fn; }
-void ppu_set_chrram(uint8_t *ptr, size_t size) { chrram_ptr = ptr; chrram_size = size; }
+void ppu_set_line_sync(void (*fn)(int))       { line_sync       = fn; }
+void ppu_set_chrram(uint8_t *ptr, size_t size)
+{
+    chrram_ptr = ptr; chrram_size = size;
+    ppu_chr_cache_flush();
+}
 
 void ppu_set_region(bool is_pal)
 {
     ppu_is_pal = is_pal;
     ppu.is_pal_system = is_pal;
+    ppu.line_class = line_class_of(ppu.scanline);
+    ppu_select_variant();
 }
 
 bool ppu_frame_complete(void)
@@ -715,6 +1254,66 @@ bool ppu_frame_complete(void)
     return false;
 }
 
+/* PPU dots until the first one that may fetch patterns, 0 if this one may */
+static int ppu_dots_to_fetch(void)
+{
+    if (!RENDERING_ENABLED)
+        return INT_MAX;
+    if (IS_VISIBLE_LINE || IS_PRERENDER_LINE)
+        return 0;
+    return (PPU_SCANLINES_PER_FRAME - 1) * PPU_DOTS_PER_SCANLINE
+           - (ppu.scanline * PPU_DOTS_PER_SCANLINE + ppu.dot) + 1;
+}
+
+/* PPU dots over which A12 cannot change, so the MMC3 M2 counter may be
+ * ticked for all of them up front: until the next rendered line, or on
+ * one until the fetches switch between the background and sprite pattern
+ * tables.  0 while the next fetch may still move A12 (8x16 sprites pick
+ * a table per sprite) */
+static int ppu_dots_to_a12(void)
+{
+    bool bg  = (ppu.ctrl & PPU_CTRL0F_BGADDR) != 0;
+    bool spr = (ppu.ctrl & PPU_CTRL0F_SPRADDR) != 0;
+    int dots = ppu_dots_to_fetch();
+
+    if (!mapper_ppu_hook)
+        return INT_MAX;
+    if (dots)
+        return dots;
+    if (ppu.dot < 257)
+        return (bg == mmc3_a12_level) ? 257 - ppu.dot : 0;
+    if (ppu.dot < 321)
+        return (!(ppu.ctrl & PPU_CTRL0F_SPR16) && spr == mmc3_a12_level)
+               ? 321 - ppu.dot : 0;
+    return (bg == mmc3_a12_level) ? PPU_DOTS_PER_SCANLINE - ppu.dot : 0;
+}
+
+/* Lower bound, in CPU cycles, on when the PPU next does something the CPU
+ * can see without touching a register: raise NMI, finish the frame, or
+ * clock an A12-driven mapper IRQ.  The CPU may run that far ahead; the
+ * cycle containing the event is the last one of its timeslice. */
+int ppu_cycles_to_event(void)
+{
+    int lines = PPU_SCANLINES_PER_FRAME;
+    int pos   = ppu.scanline * PPU_DOTS_PER_SCANLINE + ppu.dot;
+    int vbl   = 241 * PPU_DOTS_PER_SCANLINE + 1;
+    /* dots (ppu_clock calls) until the frame wraps; one less on a skip */
+    int dots  = lines * PPU_DOTS_PER_SCANLINE - pos - 1;
+
+    if (ppu.nmi_delay > 0 && ppu.nmi_delay < dots)
+        dots = ppu.nmi_delay;
+    if ((ppu.ctrl & PPU_CTRL0F_NMI) && pos <= vbl && vbl - pos + 1 < dots)
+        dots = vbl - pos + 1;
+
+    /* pattern fetches toggle A12 on every rendered line */
+    if (mapper_ppu_hook && ppu_dots_to_fetch() < dots)
+        dots = ppu_dots_to_fetch();
+
+    /* 3 dots per CPU cycle on NTSC, 3 or 4 on PAL */
+    dots = ppu_is_pal ? (dots + 3) / 4 : (dots + 2) / 3;
+    return dots > 0 ? dots : 1;
+}
+
 void ppu_reset(int hard)
 {
     (void)hard;
@@ -725,7 +1324,7 @@ void ppu_reset(int hard)
         _lines = ppu.fb->line;
         _active_lines = ppu.fb->height; /* 240 lines for NTSC/PAL */
     }
-    ppu.status = rand() & 0xE0; /* bits 7-5 random on power-up */
+    ppu.status = nes_random() & 0xE0; /* bits 7-5 random on power-up */
     ppu.open_bus = 0;
     ppu.phase_mod3 = 0;
     ppu.pal_ppu_accum = 0;
@@ -743,7 +1342,7 @@ void ppu_reset(int hard)
     ppu.spr_fetch_slot = 0;
     ppu.spr_fetch_phase = 0;
     ppu.spr_tmp_y = ppu.spr_tmp_tile = ppu.spr_tmp_attr = ppu.spr_tmp_x = 0;
-    ppu.spr_lo = ppu.spr_hi = 0;
+    ppu.spr_pt = 0;
 
     ppu.nmi_prev = false;
     ppu.nmi_delay = 0;
@@ -762,6 +1361,11 @@ void ppu_reset(int hard)
     nametable_mapping[3] = 1;  /* NT $2C00 -> CIRAM $0400 */
     
     init_bitrev();
+    init_spread();
+    init_dot_actions();
+    ppu.line_class = line_class_of(ppu.scanline);
+    ppu_chr_cache_flush();
+    pal_snap_reset();
 }
 
 /* ─────────────────── Master clock ─────────────────── */
@@ -772,55 +1376,113 @@ void ppu_mmc3_m2_tick(int cycles) {
         if (mmc3_a12_low_m2_count > 8) mmc3_a12_low_m2_count = 8; /* clamp */
     }
 }
-void ppu_clock(void)
+/* Sprite pattern fetch for dots 257-320: slot per 8 dots */
+ALWAYS_INLINE void sprite_fetch(const int var, const bool prerender)
+{
+    uint8_t rel = ppu.dot - 257;
+    uint8_t slot = rel >> 3;
+    uint8_t phase = rel & 7;
+    ppu.spr_fetch_slot = slot;
+    ppu.spr_fetch_phase = phase;
+
+    uint8_t spr_h = (ppu.ctrl & PPU_CTRL0F_SPR16) ? 16 : 8;
+    uint16_t cur_line = prerender ? 0 : (ppu.scanline + 1);
+
+    switch (phase) {
+    case 0:
+        ppu.spr_tmp_y = ppu.sec_oam[slot * 4 + 0];
+        break;
+    case 1:
+        ppu.spr_tmp_tile = ppu.sec_oam[slot * 4 + 1];
+        break;
+    case 2:
+        ppu.spr_tmp_attr = ppu.sec_oam[slot * 4 + 2];
+        break;
+    case 3:
+        ppu.spr_tmp_x = ppu.sec_oam[slot * 4 + 3];
+        break;
+    case 4: {
+        uint8_t row = cur_line - ppu.spr_tmp_y;
+        if (ppu.spr_tmp_attr & OAMF_VFLIP) row = (spr_h - 1) - row;
+        uint8_t tile = ppu.spr_tmp_tile;
+        uint16_t addr;
+        if (spr_h == 16) {
+            uint8_t even_tile = tile & 0xFE;
+            uint16_t bank = (tile & 1) ? 0x1000 : 0x0000;
+            uint8_t fine = row & 7;
+            uint16_t offset = (row & 8) ? 16 : 0;
+            addr = bank + even_tile * 16 + offset + fine;
+        } else {
+            uint16_t base = (ppu.ctrl & PPU_CTRL0F_SPRADDR) ? 0x1000 : 0x0000;
+            addr = base + tile * 16 + row;
+        }
+        if (var & PPU_VAR_LATCH) {
+            uint16_t spr_base = (spr_h == 16)
+                               ? ((tile & 1) ? 0x1000 : 0x0000)
+                               : ((ppu.ctrl & PPU_CTRL0F_SPRADDR) ? 0x1000 : 0x0000);
+            ppu_latchfunc(spr_base, tile);
+        }
+        ppu.spr_fetch_addr = addr;
+        uint16_t lo = chr_fetch_row(addr, (ppu.spr_tmp_attr & OAMF_HFLIP) != 0, var);
+        ppu.spr_pt = (ppu.spr_pt & CHR_ROW_HI) | (lo & CHR_ROW_LO);
+        break;
+    }
+    case 5: {
+        uint16_t hi = chr_fetch_row(ppu.spr_fetch_addr + 8, (ppu.spr_tmp_attr & OAMF_HFLIP) != 0, var);
+        ppu.spr_pt = (ppu.spr_pt & CHR_ROW_LO) | (hi & CHR_ROW_HI);
+        break;
+    }
+    case 6: /* second dummy read pair: only A12 sees it */
+        if (var & PPU_VAR_A12) mmc3_track_a12(ppu.spr_fetch_addr);
+        break;
+    case 7:
+        if (var & PPU_VAR_A12) mmc3_track_a12(ppu.spr_fetch_addr);
+        if (slot < ppu.sprite_count) {
+            spr_unit_t *u = &ppu.spr[slot];
+            u->x      = ppu.spr_tmp_x;
+            u->pt     = ppu.spr_pt;
+            u->attr   = ppu.spr_tmp_attr;
+            u->in_range = true;
+            if (ppu.spr_tmp_x < ppu.next_sprite_xmin)
+                ppu.next_sprite_xmin = ppu.spr_tmp_x;
+        }
+        break;
+    }
+}
+
+ALWAYS_INLINE void ppu_clock_v(const int var)
 {
+    const bool pal = (var & PPU_VAR_PAL) != 0;
+    uint16_t a = dot_actions[ppu.line_class][ppu.dot];
+
+    if (!RENDERING_ENABLED) a &= ~DOT_RENDER_ONLY;
+
     nmi_step();
 
-    if (ppu.dot == 0) {
+    if (a & DOT_LINE_START) {
         ppu.sprite_zero_this  = ppu.sprite_zero_next;
         ppu.sprite0_slot_this = ppu.sprite0_slot_next;
+        if (ppu.line_class == LINE_VISIBLE) pal_line_begin();
+        if (line_sync && draw_enabled && ppu.scanline <= PPU_VISIBLE_Y)
+            line_sync(ppu.scanline);
     }
 
     /* 1. Visible pixel -------------------------------------------------- */
-    if (IS_VISIBLE_LINE && ppu.dot >= 1 && ppu.dot <= 256) {
-        /* Always resolve sprite/background priority so side effects such as
-         * sprite-0 hits occur even if we skip writing the final pixel. */
-        uint8_t bg_pal_row, bg_px;        bg_px  = bg_pixel(&bg_pal_row);
-        uint8_t spr_pal_row, spr_pri, spr_px; spr_px = sprite_pixel(&spr_pal_row, &spr_pri);
-
+    if (a & DOT_PIXEL) {
         if (draw_enabled) {
+            uint8_t bg_pal_row, bg_px;        bg_px  = bg_pixel(&bg_pal_row);
+            uint8_t spr_pal_row, spr_pri, spr_px; spr_px = sprite_pixel(&spr_pal_row, &spr_pri);
             uint8_t *fbline = ppu.fb->line[ppu.scanline];
-            uint8_t final_idx;
-            if (!spr_px && !bg_px) {
-                final_idx = pal_read_raw(0);
-            } else if (!spr_px) {
-                final_idx = pal_read_raw((bg_pal_row << 2) | bg_px);
-            } else if (!bg_px) {
-                final_idx = pal_read_raw(0x10 | (spr_pal_row << 2) | spr_px);
-            } else {
-                if (spr_pri) final_idx = pal_read_raw((bg_pal_row << 2) | bg_px);
-                else         final_idx = pal_read_raw(0x10 | (spr_pal_row << 2) | spr_px);
-            }
-
-            /* Apply PPUMASK grayscale and emphasis */
-            if (ppu.mask & 0x01) { /* Grayscale */
-                final_idx = apply_grayscale(final_idx);
-            }
-            if (ppu.mask & 0xE0) { /* Emphasis bits */
-                final_idx = apply_emphasis_idx(final_idx, ppu.mask);
-            }
-
-            fbline[ppu.dot - 1] = final_idx;
+            fbline[ppu.dot - 1] = compose_pixel(bg_px, bg_pal_row, spr_px, spr_pal_row, spr_pri);
+        } else if (ppu.spr_line_zero && !(ppu.status & PPU_STATF_STRIKE)) {
+            /* Nothing drawn: the only visible side effect left is sprite-0 hit */
+            sprite0_probe();
         }
     }
 
     /* 2. Shift registers ------------------------------------------------ */
-    if (RENDERING_ENABLED) {
-        if ((ppu.dot >= 2 && ppu.dot <= 257) || (ppu.dot >= 321 && ppu.dot <= 336))
-            bg_shift();
-        if (IS_VISIBLE_LINE && ppu.dot >= 1 && ppu.dot <= 256)
-            sprite_shift();
-    }
+    if (a & DOT_BG_SHIFT)  bg_shift_dot();
+    if (a & DOT_SPR_SHIFT) sprite_shift();
 
     /* 3. Background fetch & scroll ------------------------------------- */
     /*
@@ -829,46 +1491,23 @@ void ppu_clock(void)
      * first two tiles of the next scanline. These dummy fetches are required to
      * mirror hardware behaviour and keep the MMC3 A12 edge timing accurate.
      */
-    if (RENDERING_ENABLED && (IS_VISIBLE_LINE || IS_PRERENDER_LINE)) {
-        if ((ppu.dot >= 1 && ppu.dot <= 256) || (ppu.dot >= 321 && ppu.dot <= 340))
-            bg_fetch();
-        if (ppu.dot == 256) inc_y();
-        else if (ppu.dot == 257) copy_x_from_t();
-        else if (IS_PRERENDER_LINE && ppu.dot >= 280 && ppu.dot <= 304) copy_y_from_t();
-    }
+    if (a & DOT_BG_FETCH) bg_fetch(var);
+    if (a & DOT_INC_Y)    inc_y();
+    if (a & DOT_COPY_X)   copy_x_from_t();
+    if (a & DOT_COPY_Y)   copy_y_from_t();
 
     /* 4. Sprite pipeline ----------------------------------------------- */
-    if (ppu.dot == 1) {
-        /* Initialize sprite evaluation state at start of each line */
-        memset(ppu.sec_oam, 0xFF, 32);
-        ppu.eval_sprite_idx = 0;
-        ppu.eval_oam_addr = 0;
-        ppu.eval_sec_idx = 0;
-        ppu.eval_overflow = false;
-        ppu.sprite_zero_next = false;
-        ppu.sprite0_slot_next = 0xFF;
-        ppu.eval_byte_index = 0;
-        ppu.eval_read_latch = 0;
-    }
+    if (a & DOT_EVAL_BEGIN)
+        eval_sprite_begin();
 
-    /* Sprite evaluation with proper even/odd cycle behavior during 65-256 */
-    if (ppu.dot >= 65 && ppu.dot <= 256 && (IS_VISIBLE_LINE || IS_PRERENDER_LINE) && RENDERING_ENABLED) {
-        if ((ppu.dot & 1) == 1) { /* Odd cycles: 65, 67, 69, ... 255 */
-            eval_sprite_read_primary(); /* Read from primary OAM */
-        } else { /* Even cycles: 66, 68, 70, ... 256 */
-            eval_sprite_write_secondary(); /* Write to secondary OAM if in range */
-        }
-#ifndef NDEBUG
-        /* Assert correct mapping during sprite evaluation */
-        if ((ppu.dot & 1) == 1) {
-            /* Odd cycles should read from primary OAM */
-        } else {
-            /* Even cycles should write to secondary OAM */
-        }
-#endif
-    }
+    /* Sprite evaluation (dots 65-256): odd dots read primary OAM, even dots
+     * write secondary OAM; batched by eval_sync() unless $2003/$2004 forced
+     * the per-dot path */
+    if ((a & DOT_EVAL) && ppu.eval_per_dot)
+        eval_sync(ppu.dot + 1);
 
-    if (ppu.dot == 257) {
+    if (a & DOT_EVAL_END) {
+        eval_sync(257);
         ppu.oam_addr = 0; /* hardware forces this */
         ppu.oam_write_during_eval = false; /* clear after eval window */
 
@@ -889,107 +1528,45 @@ void ppu_clock(void)
     }
 
     /* Per-dot sprite tile fetch (dots 257-320) */
-    if ((IS_VISIBLE_LINE || IS_PRERENDER_LINE) && RENDERING_ENABLED &&
-        ppu.dot >= 257 && ppu.dot <= 320) {
-        uint8_t rel = ppu.dot - 257;
-        uint8_t slot = rel >> 3;
-        uint8_t phase = rel & 7;
-        ppu.spr_fetch_slot = slot;
-        ppu.spr_fetch_phase = phase;
+    if (a & DOT_SPR_FETCH)
+        sprite_fetch(var, ppu.line_class == LINE_PRERENDER);
 
-        uint8_t spr_h = (ppu.ctrl & PPU_CTRL0F_SPR16) ? 16 : 8;
-        uint16_t cur_line = IS_PRERENDER_LINE ? 0 : (ppu.scanline + 1);
-
-        switch (phase) {
-        case 0:
-            ppu.spr_tmp_y = ppu.sec_oam[slot * 4 + 0];
-            break;
-        case 1:
-            ppu.spr_tmp_tile = ppu.sec_oam[slot * 4 + 1];
-            break;
-        case 2:
-            ppu.spr_tmp_attr = ppu.sec_oam[slot * 4 + 2];
-            break;
-        case 3:
-            ppu.spr_tmp_x = ppu.sec_oam[slot * 4 + 3];
-            break;
-        case 4: {
-            uint8_t row = cur_line - ppu.spr_tmp_y;
-            if (ppu.spr_tmp_attr & OAMF_VFLIP) row = (spr_h - 1) - row;
-            uint8_t tile = ppu.spr_tmp_tile;
-            uint16_t addr;
-            if (spr_h == 16) {
-                uint8_t even_tile = tile & 0xFE;
-                uint16_t bank = (tile & 1) ? 0x1000 : 0x0000;
-                uint8_t fine = row & 7;
-                uint16_t offset = (row & 8) ? 16 : 0;
-                addr = bank + even_tile * 16 + offset + fine;
-            } else {
-                uint16_t base = (ppu.ctrl & PPU_CTRL0F_SPRADDR) ? 0x1000 : 0x0000;
-                addr = base + tile * 16 + row;
-            }
-            if (ppu_latchfunc) {
-                uint16_t spr_base = (spr_h == 16)
-                                   ? ((tile & 1) ? 0x1000 : 0x0000)
-                                   : ((ppu.ctrl & PPU_CTRL0F_SPRADDR) ? 0x1000 : 0x0000);
-                ppu_latchfunc(spr_base, tile);
-            }
-            ppu.spr_fetch_addr = addr;
-            uint8_t lo = chr_read(addr);
-            if (ppu.spr_tmp_attr & OAMF_HFLIP) lo = bitrev[lo];
-            ppu.spr_lo = lo;
-            break;
-        }
-        case 5: {
-            uint8_t hi = chr_read(ppu.spr_fetch_addr + 8);
-            if (ppu.spr_tmp_attr & OAMF_HFLIP) hi = bitrev[hi];
-            ppu.spr_hi = hi;
-            break;
-        }
-        case 6:
-            chr_read(ppu.spr_fetch_addr);
-            break;
-        case 7:
-            chr_read(ppu.spr_fetch_addr);
-            if (slot < ppu.sprite_count) {
-                spr_unit_t *u = &ppu.spr[slot];
-                u->x      = ppu.spr_tmp_x;
-                u->pt_lo  = ppu.spr_lo;
-                u->pt_hi  = ppu.spr_hi;
-                u->attr   = ppu.spr_tmp_attr;
-                u->in_range = true;
-                if (ppu.spr_tmp_x < ppu.next_sprite_xmin)
-                    ppu.next_sprite_xmin = ppu.spr_tmp_x;
-            }
-            break;
-        }
-    }
+    if (a & DOT_SPR_BUILD)
+        sprite_line_build();
 
-    if (ppu.dot == 321 && ppu.next_sprite_xmin == 255)
+    if ((a & DOT_SPR_XMIN) && ppu.next_sprite_xmin == 255)
         ppu.next_sprite_xmin = 0;
 
-    /* 5. VBlank --------------------------------------------------------- */
-    if (ppu.scanline == 241 && ppu.dot == 1) {
-        ppu.status |= PPU_STATF_VBLANK;
-        nmi_check();
-    }
-    if (IS_PRERENDER_LINE && ppu.dot == 1) {
-        ppu.status &= ~(PPU_STATF_VBLANK | PPU_STATF_STRIKE | PPU_STATF_MAXSPRITE);
-        nmi_check();
+    /* 5. VBlank and odd frame cycle skip ------------------------------- */
+    if (a & DOT_FRAME) {
+        if (ppu.line_class == LINE_VBLANK) {
+            ppu.status |= PPU_STATF_VBLANK;
+            nmi_check();
+        } else if (ppu.dot == 1) {
+            ppu.status &= ~(PPU_STATF_VBLANK | PPU_STATF_STRIKE | PPU_STATF_MAXSPRITE);
+            nmi_check();
+        } else if (!pal && ppu.odd_frame && RENDERING_ENABLED) {
+            /* On odd frames with rendering enabled, dot 339 is skipped (going
+             * directly to 341).  The skip occurs at dot 339, not 340 (NTSC only) */
+            ++ppu.dot;
+        }
     }
 
-    /* 6. Odd frame cycle skip ------------------------------------------ */
-    /* On odd frames with rendering enabled, dot 339 is skipped (going directly to 341)
-     * This timing is correct - the skip occurs at dot 339, not 340 (NTSC only) */
-    if (!ppu_is_pal && IS_PRERENDER_LINE && ppu.dot == 339 && ppu.odd_frame && RENDERING_ENABLED)
-        INC_DOT();
-
-    /* 7. Advance counters ---------------------------------------------- */
-    INC_DOT();
-
-    if (ppu.scanline == 0 && ppu.dot == 0) {
-        ppu.odd_frame = !ppu.odd_frame;
-        ppu.frame_complete = true;
+    /* 6. Advance counters ---------------------------------------------- */
+    if (++ppu.dot == PPU_DOTS_PER_SCANLINE) {
+        ppu.dot = 0;
+        if (++ppu.scanline == (pal ? PPU_SCANLINES_PER_FRAME_PAL : PPU_SCANLINES_PER_FRAME_NTSC))
+            ppu.scanline = 0;
+        ppu.line_class = line_class_of(ppu.scanline);
+
+        if (ppu.scanline == 0) {
+            ppu.odd_frame = !ppu.odd_frame;
+            ppu.frame_complete = true;
+            pal_frame_end();
+#if defined(PPU_EVENT_LOG) && PPU_EVENT_LOG
+            ev_frame_end();
+#endif
+        }
     }
 }
 
@@ -1015,7 +1592,161 @@ void ppu_step_one_cpu_cycle(void) {
     }
 }
 
+/* ─────────────────── Visible-span fast path ─────────────────── */
+/*
+ * Dots 1-256 of a rendered visible line only fetch, shift, evaluate and
+ * emit pixels.  When nothing on the CPU side can reach the PPU inside a
+ * run of them, ppu_clock_span() does the same work as that many
+ * ppu_clock() calls with the per-dot line/range/mask tests taken once.
+ * Mapper latches and A12 edges still go through the pattern fetch on their
+ * exact dot, so the output and the mapper-visible bus sequence are
+ * unchanged.  With drawing off the span only probes for sprite-0 hits.
+ */
+ALWAYS_INLINE int ppu_span_dots(void)
+{
+    if (!IS_VISIBLE_LINE || ppu.dot < 1 || ppu.dot > 256 ||
+        !RENDERING_ENABLED || ppu.nmi_delay != 0)
+        return 0;
+
+    /* a span never straddles the left-column clip */
+    return (ppu.dot <= 8 ? 9 : 257) - ppu.dot;
+}
+
+ALWAYS_INLINE void ppu_clock_span(int n, const int var)
+{
+    const int first = ppu.dot;
+    uint8_t *fbline = draw_enabled ? ppu.fb->line[ppu.scanline] + (first - 1) : NULL;
+    const bool show_bg = (ppu.mask & MASK_SHOW_BG) && ((ppu.mask & MASK_LEFT_BG) || first > 8);
+    const uint16_t bit = 0x8000 >> ppu.x;
+    const int shift = 30 - 2 * ppu.x;
+    const bool sprites = ppu.spr_line_count != 0;
+
+    for (int i = 0; i < n; ++i) {
+        if (fbline) {
+            uint8_t bg_px = 0, bg_pal_row = 0;
+            uint8_t spr_px = 0, spr_pal_row = 0, spr_pri = 0;
+
+            if (show_bg) {
+                bg_px      = (ppu.bg.pt >> shift) & 3;
+                bg_pal_row = ((ppu.bg.at_lo & bit) ? 1 : 0) | ((ppu.bg.at_hi & bit) ? 2 : 0);
+            }
+            if (sprites)
+                spr_px = sprite_pixel(&spr_pal_row, &spr_pri);
+
+            fbline[i] = compose_pixel(bg_px, bg_pal_row, spr_px, spr_pal_row, spr_pri);
+        } else if (ppu.spr_line_zero && !(ppu.status & PPU_STATF_STRIKE)) {
+            sprite0_probe();
+        }
+
+        if (ppu.dot >= 2) bg_shift_dot();
+        sprite_shift();
+
+        bg_fetch(var);
+        if (ppu.dot == 256) inc_y();
+
+        if (ppu.dot == 1)
+            eval_sprite_begin();
+        else if (ppu.eval_per_dot && ppu.dot >= 65)
+            eval_sync(ppu.dot + 1);
+
+        ++ppu.dot;
+    }
+}
+
+/* Dots from here that ppu_clock() would only count: no action in the
+ * table and no NMI or per-dot evaluation pending */
+ALWAYS_INLINE int ppu_idle_dots(void)
+{
+    if (ppu.nmi_delay != 0 || ppu.eval_per_dot)
+        return 0;
+    return dot_idle[RENDERING_ENABLED][ppu.line_class][ppu.dot];
+}
+
+/* Advance the PPU by a run of dots with no CPU access to it in between,
+ * taking visible-line stretches as spans */
+ALWAYS_INLINE void ppu_run_v(int dots, void (*clock)(void), const int var)
+{
+    while (dots > 0) {
+        int span = ppu_span_dots();
+        if (span > 0) {
+            if (span > dots) span = dots;
+            ppu_clock_span(span, var);
+            dots -= span;
+        } else if ((span = ppu_idle_dots()) > 0) {
+            if (span > dots) span = dots;
+            ppu.dot += span;
+            dots -= span;
+        } else {
+            clock();
+            --dots;
+        }
+    }
+}
+
+/* ─────────────────── Dot loop variants ─────────────────── */
+#define PPU_VARIANT(name, var)                                          \
+    static void ppu_clock_##name(void)  { ppu_clock_v(var); }           \
+    static void ppu_run_##name(int dots) { ppu_run_v(dots, ppu_clock_##name, var); }
+
+PPU_VARIANT(plain,     0)
+PPU_VARIANT(a12,       PPU_VAR_A12)
+PPU_VARIANT(latch,     PPU_VAR_LATCH | PPU_VAR_A12)
+PPU_VARIANT(pal,       PPU_VAR_PAL)
+PPU_VARIANT(pal_a12,   PPU_VAR_PAL | PPU_VAR_A12)
+PPU_VARIANT(pal_latch, PPU_VAR_PAL | PPU_VAR_LATCH | PPU_VAR_A12)
+
+static NES_LOCAL void (*ppu_clock_fn)(void)    = ppu_clock_plain;
+static NES_LOCAL void (*ppu_run_fn)(int dots)  = ppu_run_plain;
+
+/* Re-pick the dot loop after the region or a mapper hook changed */
+static void ppu_select_variant(void)
+{
+    if (ppu_latchfunc) {
+        ppu_clock_fn = ppu_is_pal ? ppu_clock_pal_latch : ppu_clock_latch;
+        ppu_run_fn   = ppu_is_pal ? ppu_run_pal_latch   : ppu_run_latch;
+    } else if (mapper_ppu_hook) {
+        ppu_clock_fn = ppu_is_pal ? ppu_clock_pal_a12 : ppu_clock_a12;
+        ppu_run_fn   = ppu_is_pal ? ppu_run_pal_a12   : ppu_run_a12;
+    } else {
+        ppu_clock_fn = ppu_is_pal ? ppu_clock_pal : ppu_clock_plain;
+        ppu_run_fn   = ppu_is_pal ? ppu_run_pal   : ppu_run_plain;
+    }
+}
+
+void ppu_clock(void)
+{
+    ppu_clock_fn();
+}
+
+/* Advance the PPU by a run of CPU cycles untouched by the CPU */
+void ppu_run(int cycles)
+{
+    nes_t *nes = ppu_get_nes();
+    int dots;
+
+    if (!ppu.is_pal_system) {
+        dots = cycles * 3;
+        ppu.phase_mod3 = (ppu.phase_mod3 + cycles) % 3;
+    } else {
+        int accum = ppu.pal_ppu_accum + cycles * 16;
+        dots = accum / 5;
+        ppu.pal_ppu_accum = accum % 5;
+    }
+    nes->ppu_cycles_total += dots;
+
+    ppu_run_fn(dots);
+}
+
 /* ─────────────────── CPU ⇆ PPU interface ($2000-$2007) ─────────────────── */
+/* $2003/$2004 access: bring evaluation up to date and, inside the window,
+ * finish the line dot by dot */
+static void eval_touch(void)
+{
+    eval_sync(ppu.dot);
+    if (ppu.dot >= 65 && ppu.dot <= 256)
+        ppu.eval_per_dot = true;
+}
+
 uint8_t ppu_read(uint32_t addr)
 {
     addr &= 7;
@@ -1030,6 +1761,7 @@ uint8_t ppu_read(uint32_t addr)
         ppu.open_bus = ret;
         break;
     case 4: /* OAMDATA */
+        eval_touch();
         if (RENDERING_ENABLED && (IS_VISIBLE_LINE || IS_PRERENDER_LINE) &&
             ppu.dot >= 65 && ppu.dot <= 256) {
             ret = ppu.eval_read_latch;
@@ -1057,19 +1789,41 @@ uint8_t ppu_read(uint32_t addr)
     return ret;
 }
 
+/* Look at PPUSTATUS without touching it.  Returns true when a $2002 read
+ * right now would return *value and leave the PPU exactly as it is, which
+ * is what the idle-loop fast-forward needs to skip a polling read. */
+bool ppu_peekstatus(uint8_t *value)
+{
+    uint8_t ret = (ppu.status & 0xE0) | (ppu.open_bus & 0x1F);
+
+    *value = ret;
+    return !(ppu.status & PPU_STATF_VBLANK) && !ppu.nmi_prev &&
+           ppu.w == 0 && ppu.open_bus == ret;
+}
+
 void ppu_write(uint32_t addr, uint8_t value)
 {
+    PPU_EVENT(0x2000 | (addr & 7), value);
     ppu.open_bus = value;
     addr &= 7;
     switch (addr) {
     case 0: /* PPUCTRL */
+        eval_sync(ppu.dot);
         ppu.ctrl = value;
         ppu.t = (ppu.t & ~0x0C00) | ((value & 0x03) << 10);
         nmi_check();  /* check immediately in case bit 7 turned on in VBlank */
         break;
-    case 1: ppu.mask = value; break;                      /* PPUMASK */
-    case 3: ppu.oam_addr = value; break;                  /* OAMADDR */
+    case 1:                                               /* PPUMASK */
+        eval_sync(ppu.dot);
+        if ((ppu.mask ^ value) & MASK_COLOUR_BITS) {
+            ppu.mask = value;
+            pal_snap_changed();
+        }
+        ppu.mask = value;
+        break;
+    case 3: eval_touch(); ppu.oam_addr = value; break;    /* OAMADDR */
     case 4: /* OAMDATA */
+        eval_touch();
         ppu.oam[ppu.oam_addr++] = value;
         /* Check for write during sprite evaluation */
         if (RENDERING_ENABLED && (IS_VISIBLE_LINE || IS_PRERENDER_LINE) &&
@@ -1110,8 +1864,18 @@ void ppu_writehigh(uint32_t addr, uint8_t val)
 {
     if (addr == PPU_OAMDMA) {
         uint16_t base = val << 8;
-        for (int i = 0; i < 256; ++i)
-            ppu.oam[ppu.oam_addr++] = nes6502_getbyte(base + i);
+        PPU_EVENT(PPU_OAMDMA, val);
+        eval_sync(ppu.dot);
+        const uint8_t *src = nes6502_getptr(base < 0x2000 ? (base & 0x7FF) : base);
+        if (src) {
+            /* RAM or a linear bank: copy the page, wrapping at OAMADDR */
+            int n = 256 - ppu.oam_addr;
+            memcpy(&ppu.oam[ppu.oam_addr], src, n);
+            memcpy(ppu.oam, src + n, 256 - n);
+        } else {
+            for (int i = 0; i < 256; ++i)
+                ppu.oam[ppu.oam_addr++] = nes6502_getbyte(base + i);
+        }
 
         /* After DMA the internal OAMADDR is reset to 0 (hardware) */
         ppu.oam_addr = 0;
@@ -1129,14 +1893,18 @@ void ppu_writehigh(uint32_t addr, uint8_t val)
         printf("OAM DMA: start_cycle=%s, total_cycles=%d\n",
                (cycles & 1) ? "odd" : "even", dma_cycles);
 #endif
-        nes_t *nes = ppu_get_nes();
-        for (int i = 0; i < dma_cycles; ++i) {
-            ppu_mmc3_m2_tick(1);
-            ppu_step_one_cpu_cycle();
-            nes6502_burn(1);
-            nes->cpu_cycles_total++;
+        /* run the PPU through the stall in spans A12 stays put over, so the
+         * M2 count can be ticked a span at a time; cycle by cycle only
+         * where a fetch may move it */
+        for (int left = dma_cycles; left > 0; ) {
+            int n = ppu_dots_to_a12() / (ppu_is_pal ? 4 : 3);
+            if (n < 1) n = 1;
+            if (n > left) n = left;
+            ppu_mmc3_m2_tick(n);
+            ppu_run(n);
+            left -= n;
         }
-        nes6502_release();
+        nes_dmaburn(dma_cycles);
 #if defined(ENABLE_VS_SYSTEM)
     } else if (addr == PPU_JOY0) { /* VS-System CHR bank switch */
         if (ppu_vromswitch) ppu_vromswitch(val);
@@ -1183,6 +1951,7 @@ void ppu_displaysprites(bool enable)
 
 void ppu_set_draw_enabled(bool enable)
 {
+    bg_shift_flush();
     draw_enabled = enable;
 }
 
@@ -1191,6 +1960,32 @@ bool ppu_enabled(void)
     return RENDERING_ENABLED;
 }
 
+int ppu_pal_snapshots(const ppu_pal_snap_t **snaps, const uint8_t **line_base)
+{
+    const pal_pool_t *pool = &pal_pool[pal_fill ^ 1];
+    *snaps = pool->snap;
+    *line_base = pool->line;
+    return pool->count;
+}
+
+int ppu_pal_live(const ppu_pal_snap_t **snaps, const uint8_t **line_base)
+{
+    const pal_pool_t *pool = &pal_pool[pal_fill];
+    *snaps = pool->snap;
+    *line_base = pool->line;
+    return pool->count;
+}
+
+uint8_t ppu_pal_resolve(const ppu_pal_snap_t *snap, uint8_t index)
+{
+    uint8_t c = snap->palette[index & PPU_PIX_INDEX];
+    if (snap->mask & 0x01) /* Grayscale */
+        c = apply_grayscale(c);
+    if (snap->mask & 0xE0) /* Emphasis bits */
+        c = apply_emphasis_idx(c, snap->mask);
+    return c;
+}
+
 /* Debug/GUI functions for pattern table and OAM display */
 void ppu_dumppattern(bitmap_t *bmp, int table_num, int x, int y, int col) 
 {
@@ -1260,6 +2055,18 @@ uint8_t *ppu_getpage(int page)
     return chr_page_ptrs[page]; 
 }
 
+void ppu_chr_cache_flush(void)
+{
+    for (int i = 0; i < PPU_CHR_CACHE_TILES; ++i)
+        chr_cache[i].src = NULL;
+}
+
+void ppu_chr_cache_stats(uint32_t *hits, uint32_t *misses)
+{
+    if (hits)   *hits = chr_cache_hits;
+    if (misses) *misses = chr_cache_misses;
+}
+
 /* Single source of truth for CHR mapping - sets up the page table used by chr_read */
 void ppu_setpage(int size, int page, uint8_t *ptr)
 {
@@ -1268,7 +2075,17 @@ void ppu_setpage(int size, int page, uint8_t *ptr)
 
     /* CHR/NT mapping: For page < 16, set chr_page_ptrs[page+i] = ptr + i*0x400 */
     for (int i = 0; i < size && (page + i) < 16; i++) {
-        chr_page_ptrs[page + i] = ptr ? ptr + (i * 0x400) : NULL;
+        uint8_t *old = chr_page_ptrs[page + i];
+        uint8_t *new_ptr = ptr ? ptr + (i * 0x400) : NULL;
+
+        /* drop decoded tiles of an outgoing pattern page */
+        if (page + i < 8 && old && old != new_ptr) {
+            for (int tile = 0; tile < 0x400; tile += 16)
+                chr_cache_drop(old + tile);
+        }
+        if (page + i < 8 && old != new_ptr)
+            PPU_EVENT(PPU_EVENT_CHR, page + i);
+        chr_page_ptrs[page + i] = new_ptr;
     }
 }
 
@@ -1291,6 +2108,8 @@ void ppu_mirrorhipages(void)
 /* State serialization implementation */
 void ppu_get_state(ppu_state_t *state)
 {
+    eval_sync(ppu.dot);
+    bg_shift_flush();
     state->ctrl = ppu.ctrl;
     state->mask = ppu.mask;
     state->status = ppu.status;
@@ -1322,14 +2141,14 @@ void ppu_get_state(ppu_state_t *state)
     state->mmc3_a12_low_m2_count = mmc3_a12_low_m2_count;
     
     /* Background pipeline state */
-    state->bg_pt_lo = ppu.bg.pt_lo;
-    state->bg_pt_hi = ppu.bg.pt_hi;
+    state->bg_pt_lo = chr_compact(ppu.bg.pt);
+    state->bg_pt_hi = chr_compact(ppu.bg.pt >> 1);
     state->bg_at_lo = ppu.bg.at_lo;
     state->bg_at_hi = ppu.bg.at_hi;
     state->bg_next_nt = ppu.bg.next_nt;
     state->bg_next_at = ppu.bg.next_at;
-    state->bg_next_pt_lo = ppu.bg.next_pt_lo;
-    state->bg_next_pt_hi = ppu.bg.next_pt_hi;
+    state->bg_next_pt_lo = (uint8_t)chr_compact(ppu.bg.next_pt);
+    state->bg_next_pt_hi = (uint8_t)chr_compact(ppu.bg.next_pt >> 1);
     
     /* Sprite pipeline state */
     state->sprite_count = ppu.sprite_count;
@@ -1357,10 +2176,13 @@ void ppu_set_state(const ppu_state_t *state)
     
     ppu.dot = state->dot;
     ppu.scanline = state->scanline;
+    ppu.line_class = line_class_of(ppu.scanline);
     ppu.odd_frame = state->odd_frame;
     
     ppu.eval_sprite_idx = state->eval_sprite_idx;
     ppu.eval_oam_addr = state->eval_oam_addr;
+    ppu.eval_dot = state->dot;
+    ppu.eval_per_dot = false;
     ppu.eval_sec_idx = state->eval_sec_idx;
     ppu.eval_overflow = state->eval_overflow;
     ppu.eval_temp_y = state->eval_temp_y;
@@ -1374,14 +2196,14 @@ void ppu_set_state(const ppu_state_t *state)
     mmc3_a12_low_m2_count = state->mmc3_a12_low_m2_count;
     
     /* Background pipeline state */
-    ppu.bg.pt_lo = state->bg_pt_lo;
-    ppu.bg.pt_hi = state->bg_pt_hi;
+    ppu.bg.pt = (chr_spread[state->bg_pt_lo & 0xFF] | ((uint32_t)chr_spread[state->bg_pt_lo >> 8] << 16))
+              | (chr_spread[state->bg_pt_hi & 0xFF] | ((uint32_t)chr_spread[state->bg_pt_hi >> 8] << 16)) << 1;
     ppu.bg.at_lo = state->bg_at_lo;
     ppu.bg.at_hi = state->bg_at_hi;
     ppu.bg.next_nt = state->bg_next_nt;
     ppu.bg.next_at = state->bg_next_at;
-    ppu.bg.next_pt_lo = state->bg_next_pt_lo;
-    ppu.bg.next_pt_hi = state->bg_next_pt_hi;
+    ppu.bg.next_pt = chr_spread[state->bg_next_pt_lo] | (chr_spread[state->bg_next_pt_hi] << 1);
+    ppu.bg_shift_pending = 0;
     
     /* Sprite pipeline state */
     ppu.sprite_count = state->sprite_count;
@@ -1391,6 +2213,7 @@ void ppu_set_state(const ppu_state_t *state)
     
     /* Frame completion state */
     ppu.frame_complete = state->frame_complete;
+    pal_snap_changed();
 }
 
 void ppu_get_oam(uint8_t oam[256])
@@ -1400,6 +2223,7 @@ void ppu_get_oam(uint8_t oam[256])
 
 void ppu_set_oam(const uint8_t oam[256])
 {
+    eval_sync(ppu.dot);
     memcpy(ppu.oam, oam, 256);
 }
 
@@ -1411,6 +2235,7 @@ void ppu_get_palette(uint8_t palette[32])
 void ppu_set_palette(const uint8_t palette[32])
 {
     memcpy(ppu.palette, palette, 32);
+    pal_snap_changed();
 }
 
 void ppu_get_ciram(uint8_t ciram_out[0x1000])
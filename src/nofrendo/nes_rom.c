@@ -207,6 +207,81 @@ static int rom_loadrom(unsigned char **rom, rominfo_t *rominfo)
    return 0;
 }
 
+/* Per-game settings the iNES header can't express, keyed by the
+** CRC32 of the PRG ROM.  ROM_FLAG_BUSCYCLE runs the game on the
+** per-cycle CPU core, for code that depends on dummy reads or on
+** where in an instruction a register access lands.
+*/
+typedef struct romdb_s
+{
+   uint32 prg_crc;
+   uint8 flags;
+} romdb_t;
+
+static const romdb_t rom_database[] =
+{
+   { 0, 0 } /* end of list */
+};
+
+#define  ROM_DB_ENTRIES    (sizeof(rom_database) / sizeof(rom_database[0]) - 1)
+
+/* Build with NES_BUSCYCLE=1 to run every game on the per-cycle core */
+#ifndef NES_BUSCYCLE
+#define  NES_BUSCYCLE      0
+#endif /* !NES_BUSCYCLE */
+
+/* CRC32 a nibble at a time: a 64 byte table instead of 1 KB of RAM */
+static uint32 rom_crc32(const uint8 *data, int length)
+{
+   static const uint32 crc_nibble[16] =
+   {
+      0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+      0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+      0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+      0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+   };
+   uint32 crc = 0xFFFFFFFF;
+
+   while (length--)
+   {
+      crc ^= *data++;
+      crc = (crc >> 4) ^ crc_nibble[crc & 0x0F];
+      crc = (crc >> 4) ^ crc_nibble[crc & 0x0F];
+   }
+
+   return ~crc;
+}
+
+/* Pick up any database flags for the loaded PRG ROM */
+static void rom_checkdatabase(rominfo_t *rominfo)
+{
+   const romdb_t *entry;
+   uint32 crc;
+
+   if (NES_BUSCYCLE)
+      rominfo->flags |= ROM_FLAG_BUSCYCLE;
+
+   /* nothing to match against: spare the load a pass over all of PRG,
+   ** unless the CRC gets logged for adding entries
+   */
+#ifndef NOFRENDO_DEBUG
+   if (0 == ROM_DB_ENTRIES)
+      return;
+#endif /* !NOFRENDO_DEBUG */
+
+   crc = rom_crc32(rominfo->rom, rominfo->rom_banks * ROM_BANK_LENGTH);
+   log_printf("PRG ROM CRC32: %08X\n", crc);
+
+   for (entry = rom_database; entry->prg_crc; entry++)
+   {
+      if (entry->prg_crc == crc)
+      {
+         rominfo->flags |= entry->flags;
+         break;
+      }
+   }
+}
+
 /* If we've got a VS. system game, load in the palette, as well */
 static void rom_checkforpal(rominfo_t *rominfo)
 {
@@ -396,7 +471,7 @@ static int rom_getheader(unsigned char **rom, rominfo_t *rominfo)
 /* Build the info string for ROM display */
 char *rom_getinfo(rominfo_t *rominfo)
 {
-   static char info[PATH_MAX + 1];
+   static NES_LOCAL char info[PATH_MAX + 1];
    char romname[PATH_MAX + 1], temp[PATH_MAX + 1];
 
    /* Look to see if we were given a path along with filename */
@@ -469,6 +544,8 @@ rominfo_t *rom_load(const char *filename)
 	if (rom_loadrom(&rom, rominfo))
       goto _fail;
 
+   rom_checkdatabase(rominfo);
+
    rom_loadsram(rominfo);
 
    /* See if there's a palette we can load up */
@@ -40,6 +40,7 @@ typedef enum
 #define  ROM_FLAG_TRAINER     0x02
 #define  ROM_FLAG_FOURSCREEN  0x04
 #define  ROM_FLAG_VERSUS      0x08
+#define  ROM_FLAG_BUSCYCLE    0x10  /* needs the per-cycle CPU core */
 
 typedef struct rominfo_s
 {
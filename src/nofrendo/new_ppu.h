@@ -67,6 +67,16 @@ extern "C" {
 /* Hardware limit */
 #define PPU_MAXSPRITE 8
 
+/* Framebuffer pixels: palette RAM index plus the generation of the colour
+ * snapshot they were drawn under, counted from the line's own snapshot */
+#define PPU_PIX_INDEX      0x1F
+#define PPU_PIX_GEN_SHIFT  5
+
+/* Colour snapshots kept per frame (at most 256) */
+#ifndef PPU_PAL_SNAPS
+#define PPU_PAL_SNAPS 32
+#endif
+
 /* -------------------------------------------------------------------------
  *  Mapper helper callback types
  * ------------------------------------------------------------------------- */
@@ -85,16 +95,21 @@ void ppu_set_mapper_hook(void (*fn)(uint16_t addr));
 void ppu_setlatchfunc(ppulatchfunc_t fn);      /* MMC-2 / MMC-4 latch */
 void ppu_setvromswitch(ppuvromswitch_t fn);    /* VS-System CHR bank  */
 void ppu_set_chrram(uint8_t *ptr, size_t size);/* Cartridge CHR RAM   */
+void ppu_chr_cache_flush(void);                /* CHR changed behind the PPU */
+void ppu_chr_cache_stats(uint32_t *hits, uint32_t *misses);
 
 /* ---- Core lifecycle ----------------------------------------------------- */
 void ppu_reset(int hard);   /* hard ≠ 0 → power-on state */
 void ppu_clock(void);       /* advance one master PPU cycle */
+void ppu_run(int cycles);   /* advance a run of CPU cycles untouched by the CPU */
 void ppu_mmc3_m2_tick(int cycles); /* advance M2-based low counter */
 void ppu_set_region(bool is_pal); /* select PAL or NTSC timing */
 bool ppu_frame_complete(void); /* true if frame just completed */
+int  ppu_cycles_to_event(void); /* CPU cycles the CPU may run ahead */
 
 /* ---- CPU ⇆ PPU bus ------------------------------------------------------ */
 uint8_t ppu_read (uint32_t addr);             /* $2000-$2007 mirrored */
+bool    ppu_peekstatus(uint8_t *value);       /* $2002 without side effects */
 void    ppu_write(uint32_t addr, uint8_t val);
 
 uint8_t ppu_readhigh (uint32_t addr);         /* $4014/$4016/$4017 …  */
@@ -112,8 +127,53 @@ void   ppu_setpal       (ppu_t *ppu, rgb_t *pal64);
 void   ppu_setdefaultpal(ppu_t *ppu);
 void   ppu_displaysprites(bool enable);
 void   ppu_set_draw_enabled(bool enable); /* skip final pixel writes when false */
+void   ppu_set_line_sync(void (*fn)(int scanline)); /* before drawn lines 0-239, 240 when done */
 bool   ppu_enabled(void);
 
+/* ---- Deferred colour ---------------------------------------------------- */
+typedef struct {
+    uint8_t palette[32];   /* palette RAM */
+    uint8_t mask;          /* PPUMASK grayscale/emphasis bits */
+} ppu_pal_snap_t;
+
+/* Snapshots of the last drawn frame; line_base[y] is the snapshot line y
+ * starts with, a pixel p uses line_base[y] + (p >> PPU_PIX_GEN_SHIFT) */
+int     ppu_pal_snapshots(const ppu_pal_snap_t **snaps, const uint8_t **line_base);
+int     ppu_pal_live(const ppu_pal_snap_t **snaps, const uint8_t **line_base); /* frame being drawn */
+uint8_t ppu_pal_resolve(const ppu_pal_snap_t *snap, uint8_t index); /* → NES colour */
+
+/* ---- Raster event log (PPU_EVENT_LOG=1, 2 to print every event) -------- */
+#if defined(PPU_EVENT_LOG) && PPU_EVENT_LOG
+#include <stdio.h>
+
+#ifndef PPU_EVENT_LOG_SIZE
+#define PPU_EVENT_LOG_SIZE 1024     /* events kept per frame */
+#endif
+
+/* Pseudo registers for events that are not CPU writes */
+#define PPU_EVENT_CHR   0x0000      /* CHR page switched, value = 1 KB page */
+#define PPU_EVENT_A12   0x0001      /* mapper clocked by an A12 rise */
+#define PPU_EVENT_KINDS 11          /* $2000-$2007, $4014, CHR, A12 */
+
+typedef struct {
+    uint16_t scanline, dot;         /* PPU position the event landed on */
+    uint16_t reg;                   /* $2000-$2007, $4014 or PPU_EVENT_* */
+    uint8_t  value;
+} ppu_event_t;
+
+typedef struct {
+    uint32_t frame;                 /* frames completed before it */
+    uint16_t events;                /* all of them, not only those kept */
+    uint16_t raster;                /* on a rendered visible line */
+    uint16_t midline;               /* of those, while pixels went out (dots 1-256) */
+    uint16_t midline_kind[PPU_EVENT_KINDS];
+} ppu_event_summary_t;
+
+int  ppu_event_kind(uint16_t reg);  /* index into midline_kind */
+const ppu_event_t *ppu_event_log(ppu_event_summary_t *summary); /* last frame */
+void ppu_event_dump(FILE *out, bool events); /* last frame's summary, and events if set */
+#endif
+
 /* Debug/GUI functions */
 void   ppu_dumppattern(bitmap_t *bmp, int table_num, int x, int y, int col);
 void   ppu_dumpoam(bitmap_t *bmp, int x, int y);
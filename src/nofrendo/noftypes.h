@@ -40,6 +40,17 @@
 #define  ZERO_LENGTH 1
 #endif
 
+/* Storage class for emulated machine state (CPU, PPU, APU, mapper,
+** input...).  Define NOFRENDO_THREADS to give every host thread its
+** own machine, so that several can run side by side; otherwise there
+** is just the one and this is empty.
+*/
+#ifdef NOFRENDO_THREADS
+#define  NES_LOCAL   __thread
+#else /* !NOFRENDO_THREADS */
+#define  NES_LOCAL
+#endif /* !NOFRENDO_THREADS */
+
 /* quell stupid compiler warnings */
 #define  UNUSED(x)   ((x) = (x))
 
@@ -101,8 +101,14 @@ static void clear(uint8 color) {};
 ** fragmentation.
 */
 
-/* Framebuffer backing store */
-static uint8 fb[DEFAULT_WIDTH * DEFAULT_HEIGHT];
+/* Framebuffer backing store; a line ring build wraps it the same way as
+** the primary buffer, the video ISR scans the lines out directly */
+#if NES_LINE_RING
+#define  FB_LINES             NES_LINE_RING
+#else
+#define  FB_LINES             DEFAULT_HEIGHT
+#endif
+static NES_LOCAL uint8 fb[DEFAULT_WIDTH * FB_LINES];
 
 /* Bitmap wrapper providing line pointers for each scanline */
 typedef struct
@@ -111,7 +117,7 @@ typedef struct
     uint8 *lines[DEFAULT_HEIGHT];
 } nes_bitmap_t;
 
-static nes_bitmap_t nes_screen;
+static NES_LOCAL nes_bitmap_t nes_screen;
 
 /* acquire the directbuffer for writing */
 static bitmap_t *lock_write(void)
@@ -123,7 +129,7 @@ static bitmap_t *lock_write(void)
     nes_screen.bmp.data = fb;
 
     for (int y = 0; y < DEFAULT_HEIGHT; y++)
-        nes_screen.lines[y] = fb + (y * DEFAULT_WIDTH);
+        nes_screen.lines[y] = fb + ((y % FB_LINES) * DEFAULT_WIDTH);
 
     return &nes_screen.bmp;
 }
@@ -142,11 +148,15 @@ static void custom_blit(bitmap_t *bmp, int num_dirties, rect_t *dirty_rects)
     (void)num_dirties;
     (void)dirty_rects;
 
+#if NES_LINE_RING
+    (void)bmp;  /* the lines already went out as the ppu drew them */
+#else
     int h = bmp->height < DEFAULT_HEIGHT ? bmp->height : DEFAULT_HEIGHT;
     int w = bmp->width < DEFAULT_WIDTH ? bmp->width : DEFAULT_WIDTH;
 
     for (int y = 0; y < h; y++)
         memcpy(fb + y * DEFAULT_WIDTH, bmp->line[y], w);
+#endif
 }
 
 viddriver_t sdlDriver =
@@ -176,7 +186,7 @@ void osd_togglefullscreen(int code)
 }
 
 //
-int _input_mask;
+NES_LOCAL int _input_mask;
 void input_key(int k, int down)
 {
     int b = -1;
@@ -294,7 +304,7 @@ int osd_init()
     return 0;
 }
 
-nes_t* _nes_p = 0;
+NES_LOCAL nes_t* _nes_p = 0;
 int nes_emulate_init(const char* path, int width, int height)
 {
     if (!_nes_p) {
@@ -315,12 +325,12 @@ int nes_emulate_init(const char* path, int width, int height)
 
     osd_setsound(_nes_p->apu->process);
     _nes_p->scanline_cycles = 0;
-    _nes_p->fiq_cycles = (int) NES_FIQ_PERIOD;
+    _nes_p->fiq_deadline = _nes_p->sync_cycles + (int) NES_FIQ_PERIOD;
     return 0;
 }
 
 void nes_renderframe(bool draw_flag);
-extern bitmap_t *primary_buffer; //, *back_buffer = NULL;
+extern NES_LOCAL bitmap_t *primary_buffer; //, *back_buffer = NULL;
 
 // emulate a frame, return
 uint8** nes_emulate_frame(bool draw_flag)
@@ -334,6 +344,22 @@ uint8** nes_emulate_frame(bool draw_flag)
         vid_flush();
         osd_getinput();
     }
+#if defined(PPU_EVENT_LOG) && PPU_EVENT_LOG
+    /* once a second: raster activity of the last frame, every event at 2 */
+    {
+        static NES_LOCAL int ev_count;
+        if (++ev_count % 60 == 0)
+            ppu_event_dump(stdout, PPU_EVENT_LOG > 1);
+    }
+#endif
+#ifdef NES_IDLE_LOG
+    /* once a second: cpu cycles the idle-loop skip stepped over last frame */
+    {
+        static NES_LOCAL int idle_count;
+        if (++idle_count % 60 == 0)
+            printf("idle skip: %d cycles\n", nes_getcontextptr()->idle_cycles);
+    }
+#endif
     if (primary_buffer)
         return primary_buffer->line;
     return NULL;
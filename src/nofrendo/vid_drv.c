@@ -35,12 +35,17 @@
 extern uint8_t** volatile _lines;
 
 /* hardware surface */
-static bitmap_t *screen = NULL;
+static NES_LOCAL bitmap_t *screen = NULL;
 
 /* primary / backbuffer surfaces */
-bitmap_t *primary_buffer = NULL; //, *back_buffer = NULL;
+NES_LOCAL bitmap_t *primary_buffer = NULL; //, *back_buffer = NULL;
 
-static viddriver_t *driver = NULL;
+static NES_LOCAL viddriver_t *driver = NULL;
+
+#if NES_LINE_RING
+/* lines shared by every NES_LINE_RING-th line of the primary buffer */
+static NES_LOCAL uint8 *ring_buffer = NULL;
+#endif
 
 /* fast automagic loop unrolling */
 #define  DUFFS_DEVICE(transfer, count) \
@@ -367,6 +372,26 @@ void vid_flush(void)
 //   primary_buffer = temp;
 }
 
+#if NES_LINE_RING
+/* Every line of the ring-backed buffer wraps onto ring_buffer; a frame
+** handed in here takes its place until the ring is asked for again */
+void vid_setframe(uint8 *frame)
+{
+   int y;
+
+   if (NULL == primary_buffer)
+      return;
+
+   for (y = 0; y < primary_buffer->height; y++)
+   {
+      if (frame)
+         primary_buffer->line[y] = frame + primary_buffer->pitch * y;
+      else
+         primary_buffer->line[y] = ring_buffer + primary_buffer->pitch * (y % NES_LINE_RING);
+   }
+}
+#endif
+
 /* emulated machine tells us which resolution it wants */
 int vid_setmode(int width, int height)
 {
@@ -378,6 +403,16 @@ int vid_setmode(int width, int height)
 //   if (NULL != back_buffer)
 //      bmp_destroy(&back_buffer);
 
+#if NES_LINE_RING
+   if (NULL == ring_buffer)
+      ring_buffer = malloc(width * NES_LINE_RING);
+   if (NULL == ring_buffer)
+      return -1;
+   primary_buffer = bmp_createhw(ring_buffer, width, height, width);
+   if (NULL == primary_buffer)
+      return -1;
+   vid_setframe(NULL);
+#else
    primary_buffer = bmp_create(width, height, 8); /* no overdraw */
    if (NULL == primary_buffer)
       return -1;
@@ -396,6 +431,7 @@ int vid_setmode(int width, int height)
          ASSERT(primary_buffer->line[y] == base + (primary_buffer->pitch * y));
       }
    }
+#endif
 
    /* Create our backbuffer */
 #if 0
@@ -408,7 +444,11 @@ int vid_setmode(int width, int height)
    }
    bmp_clear(back_buffer, GUI_BLACK);
 #endif
+#if NES_LINE_RING
+   memset(ring_buffer, GUI_BLACK, width * NES_LINE_RING);
+#else
    bmp_clear(primary_buffer, GUI_BLACK);
+#endif
 
    return 0;
 }
@@ -471,6 +511,10 @@ void vid_shutdown(void)
    if (NULL != back_buffer)
       bmp_destroy(&back_buffer);
 #endif
+#if NES_LINE_RING
+   free(ring_buffer);
+   ring_buffer = NULL;
+#endif
 
    if (driver && driver->shutdown)
       driver->shutdown();
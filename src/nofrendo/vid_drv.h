@@ -28,6 +28,13 @@
 
 #include "bitmap.h"
 
+/* Build with NES_LINE_RING set to a line count to have the emulator render
+** into a ring of that many lines, scanned out by the video ISR just behind
+** the PPU, instead of a full frame.  0 keeps the full frame. */
+#ifndef NES_LINE_RING
+#define NES_LINE_RING 0
+#endif
+
 typedef struct viddriver_s
 {
    /* name of driver */
@@ -66,6 +73,11 @@ extern void vid_blit(bitmap_t *bitmap, int src_x, int src_y, int dest_x,
                      int dest_y, int blit_width, int blit_height);
 extern void vid_flush(void);
 
+#if NES_LINE_RING
+/* point the buffer at a full frame of width * height bytes, NULL for the ring */
+extern void vid_setframe(uint8 *frame);
+#endif
+
 #endif /* _VID_DRV_H_ */
 
 /*
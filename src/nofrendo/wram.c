@@ -22,11 +22,11 @@
 #include "wram.h"
 
 /*──────────────────── Module‑scope state ────────────────────*/
-static uint8_t *base     = NULL;   /* full SRAM blob supplied by cart       */
-static int      banks    = 1;      /* number of 8 KiB pages                 */
-static int      cur_bank = 0;      /* currently mapped page index           */
-static bool     wram_en  = false;  /* enable bit – **false after reset**    */
-static bool     wram_wp  = false;  /* write‑protect bit (true = read‑only)  */
+static NES_LOCAL uint8_t *base     = NULL;   /* full SRAM blob supplied by cart       */
+static NES_LOCAL int      banks    = 1;      /* number of 8 KiB pages                 */
+static NES_LOCAL int      cur_bank = 0;      /* currently mapped page index           */
+static NES_LOCAL bool     wram_en  = false;  /* enable bit – **false after reset**    */
+static NES_LOCAL bool     wram_wp  = false;  /* write‑protect bit (true = read‑only)  */
 
 #define NES           (nes_getcontextptr())
 #define WINDOW_START  0x6000
@@ -34,7 +34,7 @@ static bool     wram_wp  = false;  /* write‑protect bit (true = read‑only)
 #define PAGE_SIZE     0x2000      /* 8 KiB */
 
 /* Local "open‑bus" page – always returns $FF */
-static uint8_t dead_page[PAGE_SIZE]; /* no initializer */
+static NES_LOCAL uint8_t dead_page[PAGE_SIZE]; /* no initializer */
 
 /*──────────────────── Internal helpers ──────────────────────*/
 static void remap_page(void)
@@ -48,6 +48,10 @@ static void remap_page(void)
 
     ctx->cpu->mem_page[6] = page0;
     ctx->cpu->mem_page[7] = page0 + 0x1000;
+
+    /* the running core holds its own copy of the page table */
+    nes6502_setpage(6, page0);
+    nes6502_setpage(7, page0 + 0x1000);
 }
 
 /* $6000‑7FFF write gate */
@@ -62,6 +66,15 @@ static void wram_write(uint32_t addr, uint8_t val)
                      [addr &  NES6502_BANKMASK] = val;
 }
 
+/* Plain RAM behind the gate: no need to catch the PPU up before a write */
+static void wram_nosync(nes_t *nes)
+{
+    for (int page = WINDOW_START >> NES6502_PAGESHIFT;
+         page <= (WINDOW_END >> NES6502_PAGESHIFT); ++page)
+        if (nes->memmap[page].write_func == wram_write)
+            nes->memmap[page].sync = 0;
+}
+
 /* Push our handler into the machine’s write‑handler table (idempotent) */
 static void add_write_handler(nes_t *nes)
 {
@@ -69,8 +82,10 @@ static void add_write_handler(nes_t *nes)
     for (int j = 0; nes->writehandler[j].write_func; ++j)
         if (nes->writehandler[j].min_range  == WINDOW_START &&
             nes->writehandler[j].max_range  == WINDOW_END   &&
-            nes->writehandler[j].write_func == wram_write)
+            nes->writehandler[j].write_func == wram_write) {
+            wram_nosync(nes);
             return;                       /* already present */
+        }
 
     int i = 0;
     while (nes->writehandler[i].write_func && i < MAX_MEM_HANDLERS - 1)
@@ -82,6 +97,10 @@ static void add_write_handler(nes_t *nes)
 
     nes->writehandler[i + 1].min_range  = 0xFFFFFFFF;   /* sentinel */
     nes->writehandler[i + 1].write_func = NULL;
+
+    /* the $60-$7F pages now belong to the gate */
+    nes_compilememmap(nes);
+    wram_nosync(nes);
 }
 
 /*──────────────────── Public MMC3 API ───────────────────────*/
@@ -304,6 +304,7 @@ uint32_t us() {
 #define P3 (color << 8)
 
 uint8_t** volatile _lines; // filled in by emulator
+const uint32_t** volatile _line_palettes = 0; // per line color tables (nes deferred color), else _palette
 volatile int _line_counter = 0;
 volatile int _frame_counter = 0;
 
@@ -395,7 +396,7 @@ void pal_init()
     }
 }
 
-void IRAM_ATTR blit_pal(uint8_t* src, uint16_t* dst)
+void IRAM_ATTR blit_pal(uint8_t* src, uint16_t* dst, const uint32_t* line_palette)
 {
     uint32_t c,color;
     bool even = _line_counter & 1;
@@ -480,9 +481,13 @@ void IRAM_ATTR blit_pal(uint8_t* src, uint16_t* dst)
 
         case EMU_NES:
             // 192 of 288 color clocks wide: roughly correct aspect ratio
-            mask = 0x3F;
-            if (!even)
-              p = _palette + 64;
+            if (line_palette) {
+              p = line_palette;     // raw ppu pixels, table already has the odd line phase
+            } else {
+              mask = 0x3F;
+              if (!even)
+                p = _palette + 64;
+            }
             dst += 88;
             break;
           
@@ -552,7 +557,7 @@ uint32_t _isr_us = 0;
 #endif
 
 // draw a line of game in NTSC
-void IRAM_ATTR blit(uint8_t* src, uint16_t* dst)
+void IRAM_ATTR blit(uint8_t* src, uint16_t* dst, const uint32_t* line_palette = 0)
 {
     uint32_t* d = (uint32_t*)dst;
     const uint32_t* p = _palette;
@@ -562,7 +567,7 @@ void IRAM_ATTR blit(uint8_t* src, uint16_t* dst)
 
     BEGIN_TIMING();
     if (_pal_) {
-        blit_pal(src,dst);
+        blit_pal(src,dst,line_palette);
         END_TIMING();
         return;
     }
@@ -613,7 +618,10 @@ void IRAM_ATTR blit(uint8_t* src, uint16_t* dst)
             */
 
         case EMU_NES:
-            mask = 0x3F;
+            if (line_palette)
+                p = line_palette;   // raw ppu pixels: palette index + snapshot generation
+            else
+                mask = 0x3F;
         case EMU_SMS:
             // AAA ABB BBC CCC
             // 4 pixels, 3 color clocks, 4 samples per cc
@@ -713,25 +721,117 @@ void IRAM_ATTR pal_sync(uint16_t* line, int i)
     pal_sync2(line+_line_width/2,_line_width/2, t & 1);
 }
 
-//  audio is buffered as 6 bit unsigned samples
-uint8_t _audio_buffer[1024];
-uint32_t _audio_r = 0;
-uint32_t _audio_w = 0;
+//  audio is buffered as 6 bit unsigned samples in a single producer (audio_write_16, AudioSink)
+//  single consumer (video_isr) ring, each side only ever moving its own index.
+//  The emulator and the line rate drift apart, so the producer resamples by up to
+//  ~1.5% to hold the ring near half full: ~30ms of slack for a slow frame.
+//  Cores that render 6 bit audio themselves go through AudioSink instead: they are
+//  asked for that many more or fewer samples and write a frame of them in place,
+//  past the end of the ring if need be, the overhang folded back on commit.
+#define AUDIO_RING_SIZE 1024
+#define AUDIO_SPAN_MAX 320                  // most samples a frame renders in place
+uint8_t _audio_buffer[AUDIO_RING_SIZE + AUDIO_SPAN_MAX];
+volatile uint32_t _audio_r = 0;
+volatile uint32_t _audio_w = 0;
+volatile uint8_t _audio_last = 0x20;        // replayed by video_isr when the ring runs dry
+volatile uint32_t _audio_underruns = 0;     // lines video_isr found the ring empty
+volatile uint32_t _audio_overruns = 0;      // samples dropped with the ring full
+
+uint32_t _audio_phase = 0;                  // 16.16 position between the last two input samples
+int _audio_s0 = 0;
+int _audio_s1 = 0;
+
+// ran dry: refill to half with the held sample rather than creep back up
+int audio_prime()
+{
+    uint32_t w = _audio_w;
+    int fill = w - _audio_r;
+    if (fill == 0) {
+        uint8_t b = _audio_last;
+        while (fill < AUDIO_RING_SIZE/2)
+            _audio_buffer[(w + fill++) & (AUDIO_RING_SIZE-1)] = b;
+        __sync_synchronize();
+        _audio_w = w + fill;
+    }
+    return fill;
+}
+
+// step through the input faster when the ring is filling, slower when draining
+uint32_t audio_step(int fill)
+{
+    return 0x10000 + (fill - AUDIO_RING_SIZE/2)*2;
+}
+
 void audio_write_16(const int16_t* s, int len, int channels)
 {
-    int b;
+    uint32_t step = audio_step(audio_prime());
+    uint32_t w = _audio_w;
     while (len--) {
-        if (_audio_w == (_audio_r + sizeof(_audio_buffer)))
-            break;
+        _audio_s0 = _audio_s1;
         if (channels == 2) {
-            b = (s[0] + s[1]) >> 9;
+            _audio_s1 = (s[0] + s[1]) >> 1;
             s += 2;
         } else
-            b = *s++ >> 8;
-        if (b < -32) b = -32;
-        if (b > 31) b = 31;
-        _audio_buffer[_audio_w++ & (sizeof(_audio_buffer)-1)] = b + 32;
+            _audio_s1 = *s++;
+
+        // every output sample that falls before this input one
+        for (; _audio_phase < 0x10000; _audio_phase += step) {
+            if (w - _audio_r == AUDIO_RING_SIZE) {
+                _audio_overruns++;
+                continue;
+            }
+            int b = (_audio_s0 + (((_audio_s1 - _audio_s0)*(int)(_audio_phase >> 4)) >> 12)) >> 8;
+            if (b < -32) b = -32;
+            if (b > 31) b = 31;
+            _audio_buffer[w++ & (AUDIO_RING_SIZE-1)] = b + 32;
+        }
+        _audio_phase -= 0x10000;
     }
+    __sync_synchronize();
+    _audio_w = w;
+}
+
+class RingSink : public AudioSink {
+    uint32_t _frac = 0;     // 16.16 samples owed from earlier frames
+public:
+    virtual int frame_samples(int n)
+    {
+        int fill = audio_prime();
+        uint64_t t = (((uint64_t)n << 32) / audio_step(fill)) + _frac;
+        int len = t >> 16;
+        _frac = t & 0xFFFF;
+
+        // a full ring squeezes the frame into what room is left
+        int room = AUDIO_RING_SIZE - fill;
+        if (room > AUDIO_SPAN_MAX)
+            room = AUDIO_SPAN_MAX;
+        if (len > room) {
+            _audio_overruns += len - room;
+            len = room;
+        }
+        return len;
+    }
+
+    virtual uint8_t* span()
+    {
+        return _audio_buffer + (_audio_w & (AUDIO_RING_SIZE-1));
+    }
+
+    virtual void commit(int len)
+    {
+        uint32_t w = _audio_w;
+        int over = (w & (AUDIO_RING_SIZE-1)) + len - AUDIO_RING_SIZE;
+        if (over > 0)
+            memcpy(_audio_buffer,_audio_buffer + AUDIO_RING_SIZE,over);
+        __sync_synchronize();
+        _audio_w = w + len;
+    }
+};
+
+RingSink _audio_sink;
+AudioSink& audio_sink()
+{
+    return _audio_sink;
 }
 
 // test pattern, must be ram
@@ -800,8 +900,13 @@ void IRAM_ATTR video_isr(volatile void* vbuf)
 
     ISR_BEGIN();
 
-    uint8_t s = _audio_r < _audio_w ? _audio_buffer[_audio_r++ & (sizeof(_audio_buffer)-1)] : 0x20;
-    audio_sample(s);
+    uint32_t r = _audio_r;
+    if (r != _audio_w) {
+        _audio_last = _audio_buffer[r & (AUDIO_RING_SIZE-1)];
+        _audio_r = r + 1;
+    } else
+        _audio_underruns++;
+    audio_sample(_audio_last);
     //audio_sample(_sin64[_x++ & 0x3F]);
 
 #ifdef IR_PIN
@@ -817,7 +922,7 @@ void IRAM_ATTR video_isr(volatile void* vbuf)
         } else if (i < _active_lines + 32) {    // active video 32-272
             sync(buf,_hsync);
             burst(buf);
-            blit(_lines[i-32],buf + _active_start);
+            blit(_lines[i-32],buf + _active_start,_line_palettes ? _line_palettes[i-32] : 0);
         } else if (i < 304) {                   // post render/black 272-304
             if (i < 272)                        // slight optimization here, once you have 2 blanking buffers
                 blanking(buf,false);
@@ -829,7 +934,7 @@ void IRAM_ATTR video_isr(volatile void* vbuf)
         if (i < _active_lines) {                // active video
             sync(buf,_hsync);
             burst(buf);
-            blit(_lines[i],buf + _active_start);
+            blit(_lines[i],buf + _active_start,_line_palettes ? _line_palettes[i] : 0);
 
         } else if (i < (_active_lines + 5)) {   // post render/black
             blanking(buf,false);
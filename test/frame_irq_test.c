@@ -0,0 +1,141 @@
+/*
+** frame_irq_test.c - host check of the NES APU frame IRQ
+**
+** Runs a tiny NROM cart whose IRQ handler acknowledges the interrupt
+** with a $4015 read and counts it, once with $4017 = $40 (IRQ inhibited)
+** and once with $4017 = $00.  Build it with every core source and run
+** it from the repository root:
+**
+**   cd src/nofrendo && gcc -std=gnu99 -I. -o ../../frame_irq_test \
+**       ../../test/frame_irq_test.c *.c -lm && cd ../.. && ./frame_irq_test
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "noftypes.h"
+#include "osd.h"
+#include "nes.h"
+
+#define  TEST_FRAMES    60
+#define  IRQ_COUNT      0x10     /* zero page byte the handler counts in */
+
+/* what the port's osd layer normally provides */
+uint8_t** volatile _lines;
+int _active_lines;
+
+static char rom[16 + 0x4000 + 0x2000];
+
+char *osd_getromdata(void)
+{
+   return rom;
+}
+
+void osd_getsoundinfo(sndinfo_t *info)
+{
+   info->sample_rate = 15720;
+   info->bps = 8;
+}
+
+void osd_setsound(void (*playfunc)(void *buffer, int length))
+{
+   UNUSED(playfunc);
+}
+
+void osd_shutdown(void)
+{
+}
+
+int nes_emulate_init(const char *path, int width, int height);
+uint8 **nes_emulate_frame(bool draw_flag);
+
+/* NROM-128: write the frame counter, enable IRQs and spin */
+static void build_rom(uint8 frame_counter)
+{
+   static const uint8 reset[] =
+   {
+      0x78,                   /* sei          */
+      0xD8,                   /* cld          */
+      0xA2, 0xFF,             /* ldx #$FF     */
+      0x9A,                   /* txs          */
+      0xA9, 0x00,             /* lda #0       */
+      0x85, IRQ_COUNT,        /* sta count    */
+      0xA9, 0x00,             /* lda #value   (patched) */
+      0x8D, 0x17, 0x40,       /* sta $4017    */
+      0x58,                   /* cli          */
+      0x4C, 0x0F, 0xC0,       /* jmp *        */
+   };
+   static const uint8 irq[] =
+   {
+      0x48,                   /* pha          */
+      0xAD, 0x15, 0x40,       /* lda $4015    */
+      0xE6, IRQ_COUNT,        /* inc count    */
+      0x68,                   /* pla          */
+      0x40,                   /* rti          */
+   };
+   uint8 *prg = (uint8 *) rom + 16;
+
+   memset(rom, 0, sizeof(rom));
+   memcpy(rom, "NES\x1A\x01\x01", 6);
+   memcpy(prg, reset, sizeof(reset));
+   prg[10] = frame_counter;
+   memcpy(prg + 0x100, irq, sizeof(irq));
+
+   prg[0x3FFA] = 0x00; prg[0x3FFB] = 0xC1;   /* nmi, never enabled */
+   prg[0x3FFC] = 0x00; prg[0x3FFD] = 0xC0;   /* reset */
+   prg[0x3FFE] = 0x00; prg[0x3FFF] = 0xC1;   /* irq */
+}
+
+/* a cart can't be swapped in place, so each case runs in its own process;
+** it exits with the IRQ count, or 255 when the IRQ was left unacknowledged
+*/
+static int run(uint8 frame_counter)
+{
+   pid_t pid;
+   int status, i;
+
+   pid = fork();
+   if (0 == pid)
+   {
+      nes_t *machine;
+
+      build_rom(frame_counter);
+      if (nes_emulate_init("frame_irq_test.nes", 256, 240))
+         exit(254);
+
+      for (i = 0; i < TEST_FRAMES; i++)
+         nes_emulate_frame(false);
+
+      machine = nes_getcontextptr();
+      exit(machine->fiq_occurred ? 255 : machine->cpu->mem_page[0][IRQ_COUNT]);
+   }
+
+   if (pid < 0 || pid != waitpid(pid, &status, 0) || !WIFEXITED(status))
+      return -1;
+   return WEXITSTATUS(status);
+}
+
+int main(void)
+{
+   int failed = 0;
+   int count;
+
+   /* inhibited: the frame counter must stay silent */
+   count = run(0x40);
+   printf("$4017 = $40: %d frame IRQs\n", count);
+   if (0 != count)
+      failed = 1;
+
+   /* enabled: one per 29830 cycles, each acknowledged by the $4015 read */
+   count = run(0x00);
+   printf("$4017 = $00: %d frame IRQs\n", count);
+   if (count < TEST_FRAMES - 2 || count > TEST_FRAMES + 2)
+      failed = 1;
+
+   printf("%s\n", failed ? "FAIL" : "PASS");
+   return failed;
+}